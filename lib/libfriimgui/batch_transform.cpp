@@ -0,0 +1,264 @@
+#include "batch_transform.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FRIIMGUI_X86
+#include <immintrin.h>
+#endif
+
+namespace friimgui {
+
+namespace {
+
+struct Kernels {
+    const char *name;
+    void (*planar)(const AffineTransform &, float *, float *, size_t);
+    void (*interleaved)(const AffineTransform &, float *, size_t);
+};
+
+void planarScalar(
+    const AffineTransform &m,
+    float *xs,
+    float *ys,
+    size_t count
+) {
+    for (size_t i = 0; i < count; ++i) {
+        const float x = xs[i];
+        const float y = ys[i];
+        xs[i] = m.a * x + m.c * y + m.tx;
+        ys[i] = m.b * x + m.d * y + m.ty;
+    }
+}
+
+// Coordinates alternate x and y, count is the number of points
+void interleavedScalar(const AffineTransform &m, float *xy, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const float x = xy[2 * i];
+        const float y = xy[2 * i + 1];
+        xy[2 * i] = m.a * x + m.c * y + m.tx;
+        xy[2 * i + 1] = m.b * x + m.d * y + m.ty;
+    }
+}
+
+#ifdef FRIIMGUI_X86
+
+__attribute__((target("sse2"))) void planarSse(
+    const AffineTransform &m,
+    float *xs,
+    float *ys,
+    size_t count
+) {
+    const __m128 a = _mm_set1_ps(m.a);
+    const __m128 b = _mm_set1_ps(m.b);
+    const __m128 c = _mm_set1_ps(m.c);
+    const __m128 d = _mm_set1_ps(m.d);
+    const __m128 tx = _mm_set1_ps(m.tx);
+    const __m128 ty = _mm_set1_ps(m.ty);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 x = _mm_loadu_ps(xs + i);
+        const __m128 y = _mm_loadu_ps(ys + i);
+        _mm_storeu_ps(
+            xs + i,
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(a, x), _mm_mul_ps(c, y)), tx)
+        );
+        _mm_storeu_ps(
+            ys + i,
+            _mm_add_ps(_mm_add_ps(_mm_mul_ps(b, x), _mm_mul_ps(d, y)), ty)
+        );
+    }
+    planarScalar(m, xs + i, ys + i, count - i);
+}
+
+// Each point is multiplied by [a, d] and by [c, b] with its coordinates
+// swapped, the sum of both is the transformed point
+__attribute__((target("sse2"))) void interleavedSse(
+    const AffineTransform &m,
+    float *xy,
+    size_t count
+) {
+    const __m128 diagonal = _mm_setr_ps(m.a, m.d, m.a, m.d);
+    const __m128 antidiagonal = _mm_setr_ps(m.c, m.b, m.c, m.b);
+    const __m128 translation = _mm_setr_ps(m.tx, m.ty, m.tx, m.ty);
+
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m128 p = _mm_loadu_ps(xy + 2 * i);
+        const __m128 swapped = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 3, 0, 1));
+        const __m128 sum = _mm_add_ps(
+            _mm_mul_ps(p, diagonal),
+            _mm_mul_ps(swapped, antidiagonal)
+        );
+        _mm_storeu_ps(xy + 2 * i, _mm_add_ps(sum, translation));
+    }
+    interleavedScalar(m, xy + 2 * i, count - i);
+}
+
+__attribute__((target("avx,fma"))) void planarAvx(
+    const AffineTransform &m,
+    float *xs,
+    float *ys,
+    size_t count
+) {
+    const __m256 a = _mm256_set1_ps(m.a);
+    const __m256 b = _mm256_set1_ps(m.b);
+    const __m256 c = _mm256_set1_ps(m.c);
+    const __m256 d = _mm256_set1_ps(m.d);
+    const __m256 tx = _mm256_set1_ps(m.tx);
+    const __m256 ty = _mm256_set1_ps(m.ty);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 x = _mm256_loadu_ps(xs + i);
+        const __m256 y = _mm256_loadu_ps(ys + i);
+        _mm256_storeu_ps(
+            xs + i,
+            _mm256_fmadd_ps(a, x, _mm256_fmadd_ps(c, y, tx))
+        );
+        _mm256_storeu_ps(
+            ys + i,
+            _mm256_fmadd_ps(b, x, _mm256_fmadd_ps(d, y, ty))
+        );
+    }
+    planarScalar(m, xs + i, ys + i, count - i);
+}
+
+__attribute__((target("avx,fma"))) void interleavedAvx(
+    const AffineTransform &m,
+    float *xy,
+    size_t count
+) {
+    const __m256 diagonal = _mm256_setr_ps(
+        m.a, m.d, m.a, m.d, m.a, m.d, m.a, m.d
+    );
+    const __m256 antidiagonal = _mm256_setr_ps(
+        m.c, m.b, m.c, m.b, m.c, m.b, m.c, m.b
+    );
+    const __m256 translation = _mm256_setr_ps(
+        m.tx, m.ty, m.tx, m.ty, m.tx, m.ty, m.tx, m.ty
+    );
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m256 p = _mm256_loadu_ps(xy + 2 * i);
+        const __m256 swapped = _mm256_permute_ps(p, _MM_SHUFFLE(2, 3, 0, 1));
+        const __m256 sum = _mm256_fmadd_ps(
+            swapped,
+            antidiagonal,
+            _mm256_fmadd_ps(p, diagonal, translation)
+        );
+        _mm256_storeu_ps(xy + 2 * i, sum);
+    }
+    interleavedScalar(m, xy + 2 * i, count - i);
+}
+
+#endif
+
+const Kernels &getKernels() {
+    static const Kernels kernels = []() -> Kernels {
+#ifdef FRIIMGUI_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx") && __builtin_cpu_supports("fma")) {
+            return {"AVX/FMA", &planarAvx, &interleavedAvx};
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return {"SSE2", &planarSse, &interleavedSse};
+        }
+#endif
+        return {"scalar", &planarScalar, &interleavedScalar};
+    }();
+    return kernels;
+}
+
+} // namespace
+
+void BatchTransform::transformPoints(
+    const AffineTransform &matrix,
+    float *xs,
+    float *ys,
+    size_t count
+) {
+    getKernels().planar(matrix, xs, ys, count);
+}
+
+void BatchTransform::transformPoints(
+    const AffineTransform &matrix,
+    ImVec2 *points,
+    size_t count
+) {
+    static_assert(sizeof(ImVec2) == 2 * sizeof(float));
+    getKernels().interleaved(matrix, &points->x, count);
+}
+
+void BatchTransform::transformRegions(
+    const AffineTransform &matrix,
+    Region *regions,
+    size_t count
+) {
+    // Regions are separate objects, so each one is a separate array of four
+    // corners. RegionArray keeps all corners in one array instead.
+    const Kernels &kernels = getKernels();
+    for (size_t i = 0; i < count; ++i) {
+        kernels.interleaved(matrix, &regions[i].m_points[0].x, 4);
+    }
+}
+
+const char *BatchTransform::getKernelName() {
+    return getKernels().name;
+}
+
+// ==================================================
+
+void RegionArray::add(const Region &region) {
+    for (const ImVec2 &point : region.m_points) {
+        m_xs.push_back(point.x);
+        m_ys.push_back(point.y);
+    }
+}
+
+Region RegionArray::get(size_t index) const {
+    const float *xs = m_xs.data() + 4 * index;
+    const float *ys = m_ys.data() + 4 * index;
+    return {
+        {xs[0], ys[0]},
+        {xs[1], ys[1]},
+        {xs[2], ys[2]},
+        {xs[3], ys[3]}
+    };
+}
+
+size_t RegionArray::size() const {
+    return m_xs.size() / 4;
+}
+
+void RegionArray::clear() {
+    m_xs.clear();
+    m_ys.clear();
+}
+
+void RegionArray::transformThis(const AffineTransform &matrix) {
+    BatchTransform::transformPoints(
+        matrix,
+        m_xs.data(),
+        m_ys.data(),
+        m_xs.size()
+    );
+}
+
+float *RegionArray::getXs() {
+    return m_xs.data();
+}
+
+float *RegionArray::getYs() {
+    return m_ys.data();
+}
+
+const float *RegionArray::getXs() const {
+    return m_xs.data();
+}
+
+const float *RegionArray::getYs() const {
+    return m_ys.data();
+}
+
+} // namespace friimgui
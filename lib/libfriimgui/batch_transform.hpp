@@ -0,0 +1,69 @@
+#ifndef FRIIMGUI_BATCH_TRANSFORM_HPP
+#define FRIIMGUI_BATCH_TRANSFORM_HPP
+
+#include "types.hpp"
+
+#include <imgui/imgui.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace friimgui {
+
+// Applies one matrix to whole arrays of points at once. The kernels use AVX
+// with FMA or SSE when the CPU has them, which is detected on first use,
+// and plain scalar code otherwise.
+class BatchTransform {
+public:
+    // Coordinates in separate arrays, the fastest layout.
+    static void transformPoints(
+        const AffineTransform &matrix,
+        float *xs,
+        float *ys,
+        size_t count
+    );
+
+    // Interleaved coordinates.
+    static void transformPoints(
+        const AffineTransform &matrix,
+        ImVec2 *points,
+        size_t count
+    );
+
+    // One kernel call per region, RegionArray is faster for many regions.
+    static void transformRegions(
+        const AffineTransform &matrix,
+        Region *regions,
+        size_t count
+    );
+
+    // Name of the kernel chosen for this CPU.
+    static const char *getKernelName();
+};
+
+// ==================================================
+
+// Corners of many regions in structure of arrays layout, corner i of region
+// r is at index 4 r + i of both coordinate arrays.
+class RegionArray {
+public:
+    void add(const Region &region);
+    Region get(size_t index) const;
+    size_t size() const;
+    void clear();
+
+    void transformThis(const AffineTransform &matrix);
+
+    float *getXs();
+    float *getYs();
+    const float *getXs() const;
+    const float *getYs() const;
+
+private:
+    std::vector<float> m_xs;
+    std::vector<float> m_ys;
+};
+
+} // namespace friimgui
+
+#endif
@@ -0,0 +1,83 @@
+#include <libfriimgui/rasterizer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Renders ten million segments of a random walk into an 8K bitmap, in passes
+// of the size of a turtle path chunk, the way paths are exported.
+namespace {
+
+using namespace friimgui;
+
+constexpr int k_width = 7680;
+constexpr int k_height = 4320;
+constexpr size_t k_segmentCount = 10'000'000;
+constexpr size_t k_passSegments = 1 << 16;
+constexpr float k_step = 8.0f;
+
+// Small deterministic generator, the walk is the same on every run
+class Walk {
+public:
+    ImVec4 next() {
+        const float dx = (nextUnit() * 2 - 1) * k_step;
+        const float dy = (nextUnit() * 2 - 1) * k_step;
+        const ImVec4 segment(m_x, m_y, m_x + dx, m_y + dy);
+        m_x = std::clamp(m_x + dx, 0.0f, static_cast<float>(k_width));
+        m_y = std::clamp(m_y + dy, 0.0f, static_cast<float>(k_height));
+        return segment;
+    }
+
+    ImU32 color() const {
+        return IM_COL32(
+            static_cast<int>(m_x) & 0xFF,
+            static_cast<int>(m_y) & 0xFF,
+            200,
+            255
+        );
+    }
+
+private:
+    float nextUnit() {
+        m_state = m_state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<float>(m_state >> 40) / (1 << 24);
+    }
+
+    std::uint64_t m_state = 1;
+    float m_x = k_width / 2.0f;
+    float m_y = k_height / 2.0f;
+};
+
+} // namespace
+
+int main() {
+    Bitmap bitmap(k_width, k_height, IM_COL32(60, 60, 60, 255));
+    Rasterizer rasterizer(k_width, k_height);
+    Walk walk;
+
+    const auto start = std::chrono::steady_clock::now();
+    size_t passes = 0;
+    for (size_t first = 0; first < k_segmentCount; first += k_passSegments) {
+        const size_t end = std::min(first + k_passSegments, k_segmentCount);
+        rasterizer.clear();
+        for (size_t i = first; i < end; ++i) {
+            const ImVec4 segment = walk.next();
+            rasterizer.addLine(segment, walk.color());
+        }
+        rasterizer.render(bitmap);
+        ++passes;
+    }
+    const std::chrono::duration<double> elapsed
+        = std::chrono::steady_clock::now() - start;
+
+    std::printf(
+        "%dx%d, %zu segments in %zu passes: %8.1f ms  %8.1f M segments/s\n",
+        k_width,
+        k_height,
+        k_segmentCount,
+        passes,
+        elapsed.count() * 1e3,
+        k_segmentCount / elapsed.count() / 1e6
+    );
+}
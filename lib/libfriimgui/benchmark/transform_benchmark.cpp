@@ -0,0 +1,79 @@
+#include <libfriimgui/batch_transform.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+// Compares the per-Region transformation methods with the batch kernels on
+// a million regions.
+namespace {
+
+using namespace friimgui;
+
+constexpr size_t k_regionCount = 1 << 20;
+constexpr int k_repetitions = 10;
+
+void measure(const char *name, const std::function<void()> &run) {
+    run();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < k_repetitions; ++i) {
+        run();
+    }
+    const std::chrono::duration<double> elapsed
+        = std::chrono::steady_clock::now() - start;
+
+    const double perRun = elapsed.count() / k_repetitions;
+    std::printf(
+        "%-28s %8.3f ms  %8.1f M regions/s\n",
+        name,
+        perRun * 1e3,
+        k_regionCount / perRun / 1e6
+    );
+}
+
+} // namespace
+
+int main() {
+    Transformation transformation;
+    transformation.translation.setValue({0.25f, -0.5f});
+    transformation.rotation.setValue(1e-4f);
+    transformation.rotation.setPivot({0.5f, 0.5f});
+    transformation.scale.setValue(1.0f);
+    transformation.scale.setPivot({-0.5f, 0.5f});
+    const AffineTransform &matrix = transformation.getMatrix();
+
+    std::vector<Region> regions;
+    RegionArray regionArray;
+    regions.reserve(k_regionCount);
+    for (size_t i = 0; i < k_regionCount; ++i) {
+        const Region region = Region::createAtPosCenter(
+            static_cast<int>(i % 1024),
+            static_cast<int>(i / 1024),
+            8,
+            8
+        );
+        regions.push_back(region);
+        regionArray.add(region);
+    }
+
+    std::printf("Kernel: %s\n", BatchTransform::getKernelName());
+    measure("Region scale/rotate/move", [&] {
+        for (Region &region : regions) {
+            region.scaleThis(transformation.scale);
+            region.rotateThis(transformation.rotation);
+            region.translateThis(transformation.translation);
+        }
+    });
+    measure("Region::transformThis", [&] {
+        for (Region &region : regions) {
+            region.transformThis(matrix);
+        }
+    });
+    measure("BatchTransform (regions)", [&] {
+        BatchTransform::transformRegions(matrix, regions.data(), k_regionCount);
+    });
+    measure("RegionArray (SoA)", [&] {
+        regionArray.transformThis(matrix);
+    });
+}
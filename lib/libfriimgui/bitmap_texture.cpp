@@ -0,0 +1,78 @@
+#include "bitmap_texture.hpp"
+#include "window.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace friimgui {
+
+BitmapTexture::BitmapTexture() :
+    m_id(0),
+    m_width(0),
+    m_height(0) {
+}
+
+BitmapTexture::~BitmapTexture() {
+    if (m_id != 0 && Window::hasGLContext()) {
+        glDeleteTextures(1, &m_id);
+    }
+}
+
+void BitmapTexture::upload(const Bitmap &bitmap, int firstRow, int endRow) {
+    if (! Window::hasGLContext()) {
+        return;
+    }
+
+    if (m_id == 0) {
+        glGenTextures(1, &m_id);
+        glBindTexture(GL_TEXTURE_2D, m_id);
+        // Drawn at its own size, pixels map to pixels
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    } else {
+        glBindTexture(GL_TEXTURE_2D, m_id);
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (bitmap.getWidth() != m_width || bitmap.getHeight() != m_height) {
+        m_width = bitmap.getWidth();
+        m_height = bitmap.getHeight();
+        glTexImage2D(
+            GL_TEXTURE_2D,
+            0,
+            GL_RGBA,
+            m_width,
+            m_height,
+            0,
+            GL_RGBA,
+            GL_UNSIGNED_BYTE,
+            bitmap.getPixels()
+        );
+        return;
+    }
+
+    firstRow = std::max(firstRow, 0);
+    endRow = std::min(endRow, m_height);
+    if (firstRow >= endRow) {
+        return;
+    }
+    glTexSubImage2D(
+        GL_TEXTURE_2D,
+        0,
+        0,
+        firstRow,
+        m_width,
+        endRow - firstRow,
+        GL_RGBA,
+        GL_UNSIGNED_BYTE,
+        bitmap.getPixels() + static_cast<size_t>(firstRow) * m_width
+    );
+}
+
+ImTextureID BitmapTexture::getId() const {
+    return (ImTextureID)(intptr_t)m_id;
+}
+
+} // namespace friimgui
@@ -0,0 +1,41 @@
+#ifndef FRIIMGUI_BITMAP_TEXTURE_HPP
+#define FRIIMGUI_BITMAP_TEXTURE_HPP
+
+#include "rasterizer.hpp"
+
+#include <glad/glad.h>
+
+#include <imgui/imgui.h>
+
+namespace friimgui {
+
+// GL texture holding a copy of a Bitmap rendered on the CPU, for bitmaps
+// that change only in part from frame to frame. Used on the render thread.
+//
+// Without a GL context, in headless windows, nothing is uploaded and the id
+// stays zero. A texture still held when the window is released goes with
+// its context.
+class BitmapTexture {
+public:
+    BitmapTexture();
+    ~BitmapTexture();
+
+    BitmapTexture(const BitmapTexture &) = delete;
+    BitmapTexture &operator= (const BitmapTexture &) = delete;
+
+    // Uploads the rows [firstRow, endRow) of the bitmap, or all of it if
+    // its size differs from the previous upload.
+    void upload(const Bitmap &bitmap, int firstRow, int endRow);
+
+    // Zero until the first upload.
+    ImTextureID getId() const;
+
+private:
+    GLuint m_id;
+    int m_width;
+    int m_height;
+};
+
+} // namespace friimgui
+
+#endif
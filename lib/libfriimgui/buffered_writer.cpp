@@ -0,0 +1,150 @@
+#include "buffered_writer.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace friimgui {
+
+namespace {
+
+// Longest text produced by formatting a single number.
+constexpr size_t k_maxNumberLength = 64;
+
+constexpr int k_maxFastPrecision = 10;
+constexpr double k_powersOfTen[k_maxFastPrecision]
+    = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+
+} // namespace
+
+BufferedWriter::BufferedWriter(
+    const std::filesystem::path &fileName,
+    size_t capacity
+) :
+    m_file(std::fopen(fileName.string().c_str(), "wb")),
+    m_buffer(),
+    m_capacity(std::max(capacity, k_maxNumberLength)),
+    m_size(0) {
+    if (! m_file) {
+        throw std::runtime_error(
+            "Failed to open file for writing: " + fileName.string()
+        );
+    }
+    // The buffer is ours, stdio would only copy the data once more
+    std::setvbuf(m_file, nullptr, _IONBF, 0);
+    m_buffer.reset(new char[m_capacity]);
+}
+
+BufferedWriter::~BufferedWriter() {
+    if (m_size > 0) {
+        (void)std::fwrite(m_buffer.get(), 1, m_size, m_file);
+    }
+    std::fclose(m_file);
+}
+
+BufferedWriter &BufferedWriter::write(std::string_view text) {
+    if (text.size() > m_capacity) {
+        flush();
+        if (std::fwrite(text.data(), 1, text.size(), m_file) != text.size()) {
+            throw std::runtime_error("Failed to write to file");
+        }
+        return *this;
+    }
+
+    std::memcpy(reserve(text.size()), text.data(), text.size());
+    m_size += text.size();
+    return *this;
+}
+
+BufferedWriter &BufferedWriter::write(char c) {
+    *reserve(1) = c;
+    ++m_size;
+    return *this;
+}
+
+BufferedWriter &BufferedWriter::write(long long value) {
+    char *begin = reserve(k_maxNumberLength);
+    const std::to_chars_result result
+        = std::to_chars(begin, begin + k_maxNumberLength, value);
+    m_size += result.ptr - begin;
+    return *this;
+}
+
+BufferedWriter &BufferedWriter::write(unsigned long long value) {
+    char *begin = reserve(k_maxNumberLength);
+    const std::to_chars_result result
+        = std::to_chars(begin, begin + k_maxNumberLength, value);
+    m_size += result.ptr - begin;
+    return *this;
+}
+
+BufferedWriter &BufferedWriter::write(double value, int precision) {
+    char *begin = reserve(k_maxNumberLength);
+
+    // Fast path: the value scaled to an integer is printed as digits with
+    // a decimal point inserted, which is much faster than fixed to_chars
+    const double scaled
+        = precision >= 0 && precision < k_maxFastPrecision
+        ? std::round(value * k_powersOfTen[precision])
+        : HUGE_VAL;
+    if (std::fabs(scaled) < 1e18) {
+        const long long integer = static_cast<long long>(scaled);
+        const unsigned long long magnitude = integer < 0 ? -integer : integer;
+
+        char digits[24];
+        char *digitsEnd = std::to_chars(digits, digits + sizeof(digits), magnitude).ptr;
+        const int length = static_cast<int>(digitsEnd - digits);
+
+        char *out = begin;
+        if (integer < 0) {
+            *out++ = '-';
+        }
+        if (length <= precision) {
+            *out++ = '0';
+            *out++ = '.';
+            out = std::fill_n(out, precision - length, '0');
+            out = std::copy(digits, digitsEnd, out);
+        } else {
+            out = std::copy(digits, digitsEnd - precision, out);
+            if (precision > 0) {
+                *out++ = '.';
+                out = std::copy(digitsEnd - precision, digitsEnd, out);
+            }
+        }
+        m_size += out - begin;
+        return *this;
+    }
+
+    std::to_chars_result result = std::to_chars(
+        begin,
+        begin + k_maxNumberLength,
+        value,
+        std::chars_format::fixed,
+        precision
+    );
+    if (result.ec != std::errc()) {
+        // Too long in fixed notation, the shortest form always fits
+        result = std::to_chars(begin, begin + k_maxNumberLength, value);
+    }
+    m_size += result.ptr - begin;
+    return *this;
+}
+
+void BufferedWriter::flush() {
+    if (m_size > 0
+        && std::fwrite(m_buffer.get(), 1, m_size, m_file) != m_size) {
+        throw std::runtime_error("Failed to write to file");
+    }
+    m_size = 0;
+}
+
+char *BufferedWriter::reserve(size_t size) {
+    if (m_size + size > m_capacity) {
+        flush();
+    }
+    return m_buffer.get() + m_size;
+}
+
+} // namespace friimgui
@@ -0,0 +1,45 @@
+#ifndef FRIIMGUI_BUFFERED_WRITER_HPP
+#define FRIIMGUI_BUFFERED_WRITER_HPP
+
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <string_view>
+
+namespace friimgui {
+
+// Sequential text output into a file through one large buffer. Numbers are
+// formatted directly into the buffer, so writing does not allocate.
+class BufferedWriter {
+public:
+    static constexpr size_t k_defaultCapacity = 1 << 20;
+
+    BufferedWriter(
+        const std::filesystem::path &fileName,
+        size_t capacity = k_defaultCapacity
+    );
+    ~BufferedWriter();
+
+    BufferedWriter(const BufferedWriter &) = delete;
+    BufferedWriter &operator= (const BufferedWriter &) = delete;
+
+    BufferedWriter &write(std::string_view text);
+    BufferedWriter &write(char c);
+    BufferedWriter &write(long long value);
+    BufferedWriter &write(unsigned long long value);
+    BufferedWriter &write(double value, int precision);
+
+    void flush();
+
+private:
+    char *reserve(size_t size);
+
+    std::FILE *m_file;
+    std::unique_ptr<char[]> m_buffer;
+    size_t m_capacity;
+    size_t m_size;
+};
+
+} // namespace friimgui
+
+#endif
@@ -0,0 +1,183 @@
+#include "draw_data_renderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace friimgui {
+
+namespace {
+
+float edge(const ImVec2 &a, const ImVec2 &b, float px, float py) {
+    return (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+}
+
+ImVec4 unpackColor(ImU32 color) {
+    return {
+        static_cast<float>((color >> IM_COL32_R_SHIFT) & 0xFF),
+        static_cast<float>((color >> IM_COL32_G_SHIFT) & 0xFF),
+        static_cast<float>((color >> IM_COL32_B_SHIFT) & 0xFF),
+        static_cast<float>((color >> IM_COL32_A_SHIFT) & 0xFF)
+    };
+}
+
+// Source over blending of a color with channels in [0, 255]
+ImU32 blend(ImU32 dst, const ImVec4 &src) {
+    const ImVec4 d = unpackColor(dst);
+    const float a = src.w / 255.0f;
+    const auto mix = [a](float s, float t) {
+        return static_cast<ImU32>(s * a + t * (1 - a) + 0.5f);
+    };
+    return IM_COL32(
+        mix(src.x, d.x),
+        mix(src.y, d.y),
+        mix(src.z, d.z),
+        mix(255.0f, d.w)
+    );
+}
+
+} // namespace
+
+void DrawDataRenderer::setTexture(
+    ImTextureID id,
+    const unsigned char *pixels,
+    int width,
+    int height
+) {
+    m_textures[id] = {pixels, width, height};
+}
+
+void DrawDataRenderer::render(const ImDrawData &drawData, Bitmap &target)
+    const {
+    const ImVec2 origin = drawData.DisplayPos;
+    for (int l = 0; l < drawData.CmdListsCount; ++l) {
+        const ImDrawList &list = *drawData.CmdLists[l];
+        for (const ImDrawCmd &cmd : list.CmdBuffer) {
+            // Callbacks draw through GL, which is not there
+            if (cmd.UserCallback != nullptr) {
+                continue;
+            }
+
+            const Clip clip = {
+                std::max(0, static_cast<int>(cmd.ClipRect.x - origin.x)),
+                std::max(0, static_cast<int>(cmd.ClipRect.y - origin.y)),
+                std::min(
+                    target.getWidth(),
+                    static_cast<int>(cmd.ClipRect.z - origin.x)
+                ),
+                std::min(
+                    target.getHeight(),
+                    static_cast<int>(cmd.ClipRect.w - origin.y)
+                )
+            };
+            if (clip.x1 <= clip.x0 || clip.y1 <= clip.y0) {
+                continue;
+            }
+
+            const auto found = m_textures.find(cmd.GetTexID());
+            const TextureView *texture
+                = found != m_textures.end() ? &found->second : nullptr;
+
+            for (unsigned int i = 0; i + 2 < cmd.ElemCount; i += 3) {
+                ImDrawVert triangle[3];
+                for (int k = 0; k < 3; ++k) {
+                    const ImDrawIdx index
+                        = list.IdxBuffer[cmd.IdxOffset + i + k];
+                    triangle[k] = list.VtxBuffer[cmd.VtxOffset + index];
+                    triangle[k].pos.x -= origin.x;
+                    triangle[k].pos.y -= origin.y;
+                }
+                drawTriangle(target, clip, triangle, texture);
+            }
+        }
+    }
+}
+
+void DrawDataRenderer::drawTriangle(
+    Bitmap &target,
+    const Clip &clip,
+    const ImDrawVert (&v)[3],
+    const TextureView *texture
+) {
+    const ImVec2 &p0 = v[0].pos;
+    const ImVec2 &p1 = v[1].pos;
+    const ImVec2 &p2 = v[2].pos;
+    const float area = edge(p0, p1, p2.x, p2.y);
+    if (area == 0) {
+        return;
+    }
+
+    const int xBegin = std::max(
+        clip.x0,
+        static_cast<int>(std::floor(std::min({p0.x, p1.x, p2.x})))
+    );
+    const int xEnd = std::min(
+        clip.x1,
+        static_cast<int>(std::ceil(std::max({p0.x, p1.x, p2.x})))
+    );
+    const int yBegin = std::max(
+        clip.y0,
+        static_cast<int>(std::floor(std::min({p0.y, p1.y, p2.y})))
+    );
+    const int yEnd = std::min(
+        clip.y1,
+        static_cast<int>(std::ceil(std::max({p0.y, p1.y, p2.y})))
+    );
+
+    const ImVec4 c[3]
+        = {unpackColor(v[0].col), unpackColor(v[1].col), unpackColor(v[2].col)};
+    ImU32 *pixels = target.getPixels();
+
+    for (int y = yBegin; y < yEnd; ++y) {
+        for (int x = xBegin; x < xEnd; ++x) {
+            // Barycentric weights at the pixel center, dividing by the
+            // signed area accepts either winding
+            const float px = x + 0.5f;
+            const float py = y + 0.5f;
+            const float w0 = edge(p1, p2, px, py) / area;
+            const float w1 = edge(p2, p0, px, py) / area;
+            const float w2 = 1 - w0 - w1;
+            if (w0 < 0 || w1 < 0 || w2 < 0) {
+                continue;
+            }
+
+            ImVec4 color(
+                w0 * c[0].x + w1 * c[1].x + w2 * c[2].x,
+                w0 * c[0].y + w1 * c[1].y + w2 * c[2].y,
+                w0 * c[0].z + w1 * c[1].z + w2 * c[2].z,
+                w0 * c[0].w + w1 * c[1].w + w2 * c[2].w
+            );
+            if (texture != nullptr) {
+                const float u = w0 * v[0].uv.x + w1 * v[1].uv.x
+                              + w2 * v[2].uv.x;
+                const float t = w0 * v[0].uv.y + w1 * v[1].uv.y
+                              + w2 * v[2].uv.y;
+                const int tx = std::clamp(
+                    static_cast<int>(u * texture->width),
+                    0,
+                    texture->width - 1
+                );
+                const int ty = std::clamp(
+                    static_cast<int>(t * texture->height),
+                    0,
+                    texture->height - 1
+                );
+                const unsigned char *texel
+                    = texture->pixels
+                    + (static_cast<size_t>(ty) * texture->width + tx) * 4;
+                color.x *= texel[0] / 255.0f;
+                color.y *= texel[1] / 255.0f;
+                color.z *= texel[2] / 255.0f;
+                color.w *= texel[3] / 255.0f;
+            }
+            if (color.w <= 0) {
+                continue;
+            }
+
+            ImU32 &pixel
+                = pixels[static_cast<size_t>(y) * target.getWidth() + x];
+            pixel = blend(pixel, color);
+        }
+    }
+}
+
+} // namespace friimgui
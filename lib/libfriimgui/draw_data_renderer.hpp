@@ -0,0 +1,55 @@
+#ifndef FRIIMGUI_DRAW_DATA_RENDERER_HPP
+#define FRIIMGUI_DRAW_DATA_RENDERER_HPP
+
+#include "rasterizer.hpp"
+
+#include <imgui/imgui.h>
+
+#include <unordered_map>
+
+namespace friimgui {
+
+// Renders ImGui draw data into a Bitmap on the CPU, so frames can be looked
+// at without any GL context. Triangles are filled without anti-aliasing and
+// textures are sampled at the nearest texel. Textures must be registered
+// first, draw commands using an unknown texture are drawn untextured.
+class DrawDataRenderer {
+public:
+    // The pixels are RGBA8 and must outlive the renderer.
+    void setTexture(
+        ImTextureID id,
+        const unsigned char *pixels,
+        int width,
+        int height
+    );
+
+    void render(const ImDrawData &drawData, Bitmap &target) const;
+
+private:
+    struct TextureView {
+        const unsigned char *pixels;
+        int width;
+        int height;
+    };
+
+    // Pixel rectangle [x0, x1) x [y0, y1) inside the target
+    struct Clip {
+        int x0;
+        int y0;
+        int x1;
+        int y1;
+    };
+
+    static void drawTriangle(
+        Bitmap &target,
+        const Clip &clip,
+        const ImDrawVert (&v)[3],
+        const TextureView *texture
+    );
+
+    std::unordered_map<ImTextureID, TextureView> m_textures;
+};
+
+} // namespace friimgui
+
+#endif
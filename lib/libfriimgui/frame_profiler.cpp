@@ -0,0 +1,338 @@
+#include "frame_profiler.hpp"
+#include "buffered_writer.hpp"
+
+#include <algorithm>
+
+namespace friimgui {
+
+namespace {
+
+constexpr const char *k_phaseNames[k_framePhaseCount] = {
+    "Wait",
+    "Update",
+    "Build",
+    "Render",
+    "RenderDrawData",
+    "SwapBuffers"
+};
+
+float percentile(std::vector<float> &values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    const size_t rank = static_cast<size_t>(fraction * (values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+FramePercentiles calculate(std::vector<float> &values) {
+    // Higher ranks first, each call leaves the lower ones on its left
+    const float p99 = percentile(values, 0.99);
+    const float p95 = percentile(values, 0.95);
+    const float p50 = percentile(values, 0.50);
+    return {p50, p95, p99};
+}
+
+} // namespace
+
+float FrameSample::getBusyMicros() const {
+    float total = 0;
+    for (size_t i = 0; i < k_framePhaseCount; ++i) {
+        if (i != static_cast<size_t>(FramePhase::Wait)) {
+            total += phaseDurations[i];
+        }
+    }
+    return total;
+}
+
+// ==================================================
+
+FrameProfiler::ScopedPhase::ScopedPhase(
+    FrameProfiler &profiler,
+    FramePhase phase
+) :
+    m_profiler(profiler),
+    m_phase(phase),
+    m_start() {
+    if (m_profiler.m_enabled) {
+        m_start = std::chrono::steady_clock::now();
+    }
+}
+
+FrameProfiler::ScopedPhase::~ScopedPhase() {
+    if (m_profiler.m_enabled) {
+        m_profiler.addPhase(m_phase, m_start, std::chrono::steady_clock::now());
+    }
+}
+
+// ==================================================
+
+FrameProfiler &FrameProfiler::getInstance() {
+    static FrameProfiler instance;
+    return instance;
+}
+
+const char *FrameProfiler::getPhaseName(FramePhase phase) {
+    return k_phaseNames[static_cast<size_t>(phase)];
+}
+
+void FrameProfiler::setEnabled(bool enabled) {
+    m_enabled = enabled;
+    m_inFrame = false;
+}
+
+bool FrameProfiler::isEnabled() const {
+    return m_enabled;
+}
+
+void FrameProfiler::setOverlayVisible(bool visible) {
+    m_overlayVisible = visible;
+}
+
+bool FrameProfiler::isOverlayVisible() const {
+    return m_overlayVisible;
+}
+
+void FrameProfiler::beginFrame() {
+    if (! m_enabled) {
+        return;
+    }
+    m_frameStart = std::chrono::steady_clock::now();
+    m_current = {};
+    m_current.index = m_written;
+    m_current.startMicros = toMicros(m_frameStart);
+    m_inFrame = true;
+}
+
+void FrameProfiler::endFrame(const ImDrawData *drawData) {
+    if (! m_enabled || ! m_inFrame) {
+        return;
+    }
+    m_inFrame = false;
+
+    if (drawData != nullptr) {
+        m_current.vertexCount = drawData->TotalVtxCount;
+        m_current.indexCount = drawData->TotalIdxCount;
+        for (int i = 0; i < drawData->CmdListsCount; ++i) {
+            m_current.commandCount += drawData->CmdLists[i]->CmdBuffer.Size;
+        }
+    }
+
+    m_ring[m_current.index % k_capacity] = m_current;
+    m_written = m_current.index + 1;
+}
+
+std::vector<FrameSample> FrameProfiler::getSamples() const {
+    const std::uint64_t count = std::min<std::uint64_t>(m_written, k_capacity);
+
+    std::vector<FrameSample> samples;
+    samples.reserve(count);
+    for (std::uint64_t i = m_written - count; i < m_written; ++i) {
+        samples.push_back(m_ring[i % k_capacity]);
+    }
+    return samples;
+}
+
+FramePercentiles FrameProfiler::calculatePercentiles(
+    const std::vector<FrameSample> &samples,
+    FramePhase phase
+) {
+    std::vector<float> values;
+    values.reserve(samples.size());
+    for (const FrameSample &sample : samples) {
+        values.push_back(sample.phaseDurations[static_cast<size_t>(phase)]);
+    }
+    return calculate(values);
+}
+
+FramePercentiles FrameProfiler::calculateBusyPercentiles(
+    const std::vector<FrameSample> &samples
+) {
+    std::vector<float> values;
+    values.reserve(samples.size());
+    for (const FrameSample &sample : samples) {
+        values.push_back(sample.getBusyMicros());
+    }
+    return calculate(values);
+}
+
+void FrameProfiler::drawOverlay() {
+    if (! m_overlayVisible) {
+        return;
+    }
+
+    ImGui::SetNextWindowBgAlpha(0.85f);
+    if (! ImGui::Begin(
+            "Frame profiler",
+            &m_overlayVisible,
+            ImGuiWindowFlags_AlwaysAutoResize
+        )) {
+        ImGui::End();
+        return;
+    }
+
+    const std::vector<FrameSample> samples = getSamples();
+    if (samples.empty()) {
+        ImGui::TextUnformatted("No frames recorded");
+        ImGui::End();
+        return;
+    }
+
+    const FrameSample &last = samples.back();
+    ImGui::Text(
+        "%zu frames, last: %d vertices, %d indices, %d commands",
+        samples.size(),
+        last.vertexCount,
+        last.indexCount,
+        last.commandCount
+    );
+
+    std::vector<float> busy;
+    busy.reserve(samples.size());
+    for (const FrameSample &sample : samples) {
+        busy.push_back(sample.getBusyMicros() / 1000);
+    }
+    ImGui::PlotLines(
+        "##busy",
+        busy.data(),
+        static_cast<int>(busy.size()),
+        0,
+        "Busy time [ms]",
+        0,
+        FLT_MAX,
+        ImVec2(360, 60)
+    );
+
+    if (ImGui::BeginTable("##phases", 5, ImGuiTableFlags_Borders)) {
+        ImGui::TableSetupColumn("Phase [ms]");
+        ImGui::TableSetupColumn("Last");
+        ImGui::TableSetupColumn("p50");
+        ImGui::TableSetupColumn("p95");
+        ImGui::TableSetupColumn("p99");
+        ImGui::TableHeadersRow();
+
+        auto addRow = [](
+                          const char *name,
+                          float lastValue,
+                          FramePercentiles p
+                      ) {
+            ImGui::TableNextRow();
+            ImGui::TableSetColumnIndex(0);
+            ImGui::TextUnformatted(name);
+            const float values[] = {lastValue, p.p50, p.p95, p.p99};
+            for (int i = 0; i < 4; ++i) {
+                ImGui::TableSetColumnIndex(i + 1);
+                ImGui::Text("%.3f", values[i] / 1000);
+            }
+        };
+        for (size_t i = 0; i < k_framePhaseCount; ++i) {
+            const FramePhase phase = static_cast<FramePhase>(i);
+            addRow(
+                getPhaseName(phase),
+                last.phaseDurations[i],
+                calculatePercentiles(samples, phase)
+            );
+        }
+        addRow(
+            "Busy",
+            last.getBusyMicros(),
+            calculateBusyPercentiles(samples)
+        );
+        ImGui::EndTable();
+    }
+
+    if (ImGui::Button("Export CSV")) {
+        exportCsv("frame_profile.csv");
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Export trace")) {
+        exportChromeTrace("frame_profile.json");
+    }
+    ImGui::End();
+}
+
+void FrameProfiler::exportCsv(const std::filesystem::path &fileName) const {
+    BufferedWriter writer(fileName);
+    writer.write("frame,start_ms");
+    for (const char *name : k_phaseNames) {
+        writer.write(',').write(name).write("_ms");
+    }
+    writer.write(",busy_ms,vertices,indices,commands\n");
+
+    for (const FrameSample &sample : getSamples()) {
+        writer.write(static_cast<unsigned long long>(sample.index));
+        writer.write(',').write(sample.startMicros / 1000, 3);
+        for (float duration : sample.phaseDurations) {
+            writer.write(',').write(duration / 1000.0, 3);
+        }
+        writer.write(',').write(sample.getBusyMicros() / 1000.0, 3);
+        writer.write(',').write(static_cast<long long>(sample.vertexCount));
+        writer.write(',').write(static_cast<long long>(sample.indexCount));
+        writer.write(',').write(static_cast<long long>(sample.commandCount));
+        writer.write('\n');
+    }
+    writer.flush();
+}
+
+void FrameProfiler::exportChromeTrace(
+    const std::filesystem::path &fileName
+) const {
+    BufferedWriter writer(fileName);
+    writer.write("{\"traceEvents\":[");
+
+    bool first = true;
+    for (const FrameSample &sample : getSamples()) {
+        for (size_t i = 0; i < k_framePhaseCount; ++i) {
+            if (sample.phaseDurations[i] == 0) {
+                continue;
+            }
+            writer.write(first ? "\n" : ",\n");
+            first = false;
+            writer.write("{\"name\":\"").write(k_phaseNames[i]);
+            writer.write("\",\"cat\":\"frame\",\"ph\":\"X\",\"ts\":");
+            writer.write(sample.startMicros + sample.phaseStarts[i], 1);
+            writer.write(",\"dur\":").write(sample.phaseDurations[i], 1);
+            writer.write(",\"pid\":1,\"tid\":1,\"args\":{\"frame\":");
+            writer.write(static_cast<unsigned long long>(sample.index));
+            writer.write("}}");
+        }
+    }
+    writer.write("\n]}\n");
+    writer.flush();
+}
+
+FrameProfiler::FrameProfiler() :
+    m_ring(),
+    m_written(0),
+    m_current(),
+    m_epoch(std::chrono::steady_clock::now()),
+    m_frameStart(m_epoch),
+    m_inFrame(false),
+    m_enabled(true),
+    m_overlayVisible(false) {
+}
+
+double FrameProfiler::toMicros(
+    std::chrono::steady_clock::time_point time
+) const {
+    return std::chrono::duration<double, std::micro>(time - m_epoch).count();
+}
+
+void FrameProfiler::addPhase(
+    FramePhase phase,
+    std::chrono::steady_clock::time_point start,
+    std::chrono::steady_clock::time_point end
+) {
+    if (! m_inFrame) {
+        return;
+    }
+    const size_t i = static_cast<size_t>(phase);
+    m_current.phaseStarts[i] = static_cast<float>(
+        std::chrono::duration<double, std::micro>(start - m_frameStart).count()
+    );
+    m_current.phaseDurations[i] += static_cast<float>(
+        std::chrono::duration<double, std::micro>(end - start).count()
+    );
+}
+
+} // namespace friimgui
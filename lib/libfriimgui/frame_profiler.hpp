@@ -0,0 +1,128 @@
+#ifndef FRIIMGUI_FRAME_PROFILER_HPP
+#define FRIIMGUI_FRAME_PROFILER_HPP
+
+#include <imgui/imgui.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace friimgui {
+
+enum class FramePhase {
+    Wait,
+    Update,
+    Build,
+    Render,
+    RenderDrawData,
+    SwapBuffers,
+    Count
+};
+
+constexpr size_t k_framePhaseCount = static_cast<size_t>(FramePhase::Count);
+
+// Timings of a single frame in microseconds, phase starts are relative to
+// the start of the frame.
+struct FrameSample {
+    std::uint64_t index;
+    double startMicros;
+    std::array<float, k_framePhaseCount> phaseStarts;
+    std::array<float, k_framePhaseCount> phaseDurations;
+    int vertexCount;
+    int indexCount;
+    int commandCount;
+
+    // Time spent on the frame itself, without waiting for it.
+    float getBusyMicros() const;
+};
+
+struct FramePercentiles {
+    float p50;
+    float p95;
+    float p99;
+};
+
+// Records how long the phases of recent frames took. Samples are written by
+// the render thread into a fixed ring buffer without locks. Nothing guards
+// the slots, so the samples and exports must be read on the render thread
+// as well.
+class FrameProfiler {
+public:
+    static constexpr size_t k_capacity = 1024;
+
+    // Measures the phase from its construction to its destruction.
+    class ScopedPhase {
+    public:
+        ScopedPhase(FrameProfiler &profiler, FramePhase phase);
+        ~ScopedPhase();
+
+        ScopedPhase(const ScopedPhase &) = delete;
+        ScopedPhase &operator= (const ScopedPhase &) = delete;
+
+    private:
+        FrameProfiler &m_profiler;
+        FramePhase m_phase;
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    static FrameProfiler &getInstance();
+    static const char *getPhaseName(FramePhase phase);
+
+    FrameProfiler(const FrameProfiler &) = delete;
+    FrameProfiler &operator= (const FrameProfiler &) = delete;
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    void setOverlayVisible(bool visible);
+    bool isOverlayVisible() const;
+
+    void beginFrame();
+    // Takes the draw list sizes of the frame from drawData, may be null.
+    void endFrame(const ImDrawData *drawData);
+
+    // Oldest first, at most k_capacity samples.
+    std::vector<FrameSample> getSamples() const;
+
+    // Over the given samples, for one phase or for the busy time.
+    static FramePercentiles calculatePercentiles(
+        const std::vector<FrameSample> &samples,
+        FramePhase phase
+    );
+    static FramePercentiles calculateBusyPercentiles(
+        const std::vector<FrameSample> &samples
+    );
+
+    // Draws a window with the percentiles and frame times, to be called
+    // inside a frame.
+    void drawOverlay();
+
+    void exportCsv(const std::filesystem::path &fileName) const;
+    // Trace Event Format, viewable in chrome://tracing or Perfetto.
+    void exportChromeTrace(const std::filesystem::path &fileName) const;
+
+private:
+    FrameProfiler();
+
+    double toMicros(std::chrono::steady_clock::time_point time) const;
+    void addPhase(
+        FramePhase phase,
+        std::chrono::steady_clock::time_point start,
+        std::chrono::steady_clock::time_point end
+    );
+
+    std::array<FrameSample, k_capacity> m_ring;
+    std::uint64_t m_written;
+
+    FrameSample m_current;
+    std::chrono::steady_clock::time_point m_epoch;
+    std::chrono::steady_clock::time_point m_frameStart;
+    bool m_inFrame;
+    bool m_enabled;
+    bool m_overlayVisible;
+};
+
+} // namespace friimgui
+
+#endif
@@ -6,6 +6,12 @@ namespace friimgui {
 class GUIBuilder {
 public:
     virtual void build() = 0;
+
+    // While true the window renders continuously instead of waiting for
+    // events.
+    virtual bool isAnimating() const {
+        return false;
+    }
 };
 
 } // namespace friimgui
@@ -1,41 +1,29 @@
 #include "image.hpp"
+#include "sprite_batch.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
-#include <stdexcept>
+#include <utility>
 
 namespace friimgui {
 
+namespace {
+
+const ImU32 k_placeholderColor = IM_COL32(128, 128, 128, 96);
+
+} // namespace
+
 Image Image::createImage(const std::filesystem::path &fileName) {
-    int w, h, comp;
-    unsigned char *data
-        = stbi_load(fileName.string().c_str(), &w, &h, &comp, 4);
-    if (! data) {
-        throw std::runtime_error(
-            "Failed to load image from: " + fileName.string()
-        );
-    }
+    return Image(TextureCache::getInstance().acquire(fileName));
+}
 
-    GLuint tex;
-    glGenTextures(1, &tex);
-    glBindTexture(GL_TEXTURE_2D, tex);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexImage2D(
-        GL_TEXTURE_2D,
-        0,
-        GL_RGBA,
-        w,
-        h,
-        0,
-        GL_RGBA,
-        GL_UNSIGNED_BYTE,
-        data
-    );
-    stbi_image_free(data);
+int Image::getWidth() const {
+    return m_texture->getWidth();
+}
 
-    return Image(tex, w, h);
+int Image::getHeight() const {
+    return m_texture->getHeight();
 }
 
 void Image::draw(
@@ -43,35 +31,64 @@ void Image::draw(
     const Transformation &transformation
 ) {
     ImDrawList *drawList = ImGui::GetWindowDrawList();
-    Region imageRegion = Region::createAtPosCenter(0, 0, m_width, m_height);
+    const GLuint texture = m_texture->getId();
+    const ImVec2 uv0 = m_texture->getUv0();
+    const ImVec2 uv1 = m_texture->getUv1();
+    const ImVec2 size(m_texture->getWidth(), m_texture->getHeight());
 
-    imageRegion.scaleThis(transformation.scale);
-    imageRegion.rotateThis(transformation.rotation);
-    imageRegion.translateThis(transformation.translation);
-    imageRegion.translateThis(region.getP0());
+    if (texture != 0) {
+        const bool batched = SpriteBatch::getInstance().add(
+            drawList,
+            texture,
+            uv0,
+            uv1,
+            size,
+            transformation,
+            region.getP0()
+        );
+        if (batched) {
+            return;
+        }
+    }
+
+    Region imageRegion = Region::createAtPosCenter(0, 0, size);
+
+    imageRegion.transformThis(
+        transformation.getMatrix().translated(region.getP0())
+    );
+
+    if (texture == 0) {
+        // Not decoded or uploaded yet, a plain quad stands in for it
+        drawList->AddQuadFilled(
+            imageRegion.getP0(),
+            imageRegion.getP1(),
+            imageRegion.getP2(),
+            imageRegion.getP3(),
+            k_placeholderColor
+        );
+        return;
+    }
 
     drawList->AddImageQuad(
         // texture
-        (ImTextureID)(intptr_t)m_tex,
+        (ImTextureID)(intptr_t)texture,
         // vertices
         imageRegion.getP0(),
         imageRegion.getP1(),
         imageRegion.getP2(),
         imageRegion.getP3(),
         // tex coordinates
-        ImVec2(0, 0),
-        ImVec2(1, 0),
-        ImVec2(1, 1),
-        ImVec2(0, 1),
+        uv0,
+        ImVec2(uv1.x, uv0.y),
+        uv1,
+        ImVec2(uv0.x, uv1.y),
         // tint
         IM_COL32_WHITE
     );
 }
 
-Image::Image(GLuint tex, int width, int height) :
-    m_tex(tex),
-    m_width(width),
-    m_height(height) {
+Image::Image(std::shared_ptr<const Texture> texture) :
+    m_texture(std::move(texture)) {
 }
 
 } // namespace friimgui
\ No newline at end of file
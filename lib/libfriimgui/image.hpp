@@ -1,31 +1,35 @@
 #ifndef FRIIMGUI_IMAGE_HPP
 #define FRIIMGUI_IMAGE_HPP
 
+#include "texture_cache.hpp"
 #include "types.hpp"
 
-#include <glad/glad.h>
-
 #include <imgui/imgui.h>
 
 #include <filesystem>
+#include <memory>
 
 namespace friimgui {
 
+// Sprite drawn from a texture shared through the TextureCache, copies of an
+// image share the texture as well. Creating an image needs no GL context,
+// a placeholder is drawn until the texture is uploaded.
 class Image {
 public:
     static Image createImage(const std::filesystem::path &fileName);
 
+    int getWidth() const;
+    int getHeight() const;
+
     void draw(
         const friimgui::Region &region,
         const Transformation &transformation
     );
 
 private:
-    Image(GLuint tex, int width, int height);
+    Image(std::shared_ptr<const Texture> texture);
 
-    GLuint m_tex;
-    int m_width;
-    int m_height;
+    std::shared_ptr<const Texture> m_texture;
 };
 
 } // namespace friimgui
@@ -0,0 +1,509 @@
+#include "rasterizer.hpp"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb_image.h>
+#include <stb/stb_image_write.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FRIIMGUI_RASTERIZER_SSE2
+#endif
+
+namespace friimgui {
+
+namespace {
+
+struct LineSetup {
+    float x0;
+    float y0;
+    float dx;
+    float dy;
+    float invLengthSq;
+    float radius;
+    float srcAlpha;
+    ImU32 color;
+};
+
+// Contiguous pixel buffer covering the rectangle [x0, x1) x [y0, y1) of the
+// canvas, rows are stride pixels apart.
+struct TileTarget {
+    ImU32 *pixels;
+    int stride;
+    int x0;
+    int y0;
+    int x1;
+    int y1;
+};
+
+inline int floorToInt(float v) {
+    const int i = static_cast<int>(v);
+    return i - (v < i);
+}
+
+inline int ceilToInt(float v) {
+    const int i = static_cast<int>(v);
+    return i + (v > i);
+}
+
+inline ImU32 blendPixel(ImU32 dst, ImU32 src, int alpha) {
+    // alpha is in [0, 256], channels are blended as (s * a + d * (256 - a)) / 256
+    ImU32 result = 0;
+    for (int shift = 0; shift < 32; shift += 8) {
+        const ImU32 s = (src >> shift) & 0xFF;
+        const ImU32 d = (dst >> shift) & 0xFF;
+        result |= ((s * alpha + d * (256 - alpha)) >> 8) << shift;
+    }
+    return result;
+}
+
+inline float coverage(const LineSetup &line, float px, float py) {
+    const float rx = px - line.x0;
+    const float ry = py - line.y0;
+    const float t = std::clamp(
+        (rx * line.dx + ry * line.dy) * line.invLengthSq,
+        0.0f,
+        1.0f
+    );
+    const float ex = rx - t * line.dx;
+    const float ey = ry - t * line.dy;
+    return std::clamp(line.radius - std::sqrt(ex * ex + ey * ey), 0.0f, 1.0f);
+}
+
+// Blends the pixels [xBegin, xEnd) of one row with an anti-aliased line,
+// span points at the pixel xBegin. Scalar path for spans not made of whole
+// groups of four pixels.
+void blendLineSpan(
+    ImU32 *span,
+    int xBegin,
+    int xEnd,
+    float py,
+    const LineSetup &line
+) {
+    for (int x = xBegin; x < xEnd; ++x) {
+        const float cov = coverage(line, x + 0.5f, py);
+        if (cov > 0.0f) {
+            const int alpha
+                = static_cast<int>(cov * line.srcAlpha * 256.0f + 0.5f);
+            span[x - xBegin] = blendPixel(span[x - xBegin], line.color, alpha);
+        }
+    }
+}
+
+// Blends an anti-aliased line into the tile. Every row is reduced to the
+// span where the line can have any coverage, spans are then processed in
+// groups of four pixels.
+void blendLine(const TileTarget &tile, const LineSetup &line) {
+    const float minX = std::max(
+        std::min(line.x0, line.x0 + line.dx) - line.radius,
+        static_cast<float>(tile.x0)
+    );
+    const float maxX = std::min(
+        std::max(line.x0, line.x0 + line.dx) + line.radius,
+        static_cast<float>(tile.x1)
+    );
+    const int yBegin = std::max(
+        tile.y0,
+        floorToInt(std::min(line.y0, line.y0 + line.dy) - line.radius)
+    );
+    const int yEnd = std::min(
+        tile.y1,
+        ceilToInt(std::max(line.y0, line.y0 + line.dy) + line.radius)
+    );
+
+    // Horizontal extent of the line at a row is its crossing point widened
+    // by the radius stretched along the row
+    const float absDy = std::fabs(line.dy);
+    const float halfSpan = absDy > 0
+        ? line.radius / (absDy * std::sqrt(line.invLengthSq)) + 0.5f
+        : 0.0f;
+    const float crossStep = absDy > 0 ? line.dx / line.dy : 0.0f;
+    float crossX = line.x0 + (yBegin + 0.5f - line.y0) * crossStep;
+
+#ifdef FRIIMGUI_RASTERIZER_SSE2
+    const __m128 x0 = _mm_set1_ps(line.x0);
+    const __m128 dx = _mm_set1_ps(line.dx);
+    const __m128 dy = _mm_set1_ps(line.dy);
+    const __m128 invLengthSq = _mm_set1_ps(line.invLengthSq);
+    const __m128 radius = _mm_set1_ps(line.radius);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 epsilon = _mm_set1_ps(1e-12f);
+    const __m128 alphaScale = _mm_set1_ps(256.0f * line.srcAlpha);
+    const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+
+    const __m128i zeroi = _mm_setzero_si128();
+    const __m128i src16 = _mm_unpacklo_epi8(
+        _mm_set1_epi32(static_cast<int>(line.color)),
+        zeroi
+    );
+    const __m128i full16 = _mm_set1_epi16(256);
+#endif
+
+    for (int y = yBegin; y < yEnd; ++y, crossX += crossStep) {
+        float spanMin = minX;
+        float spanMax = maxX;
+        if (absDy > 0) {
+            spanMin = std::max(spanMin, crossX - halfSpan);
+            spanMax = std::min(spanMax, crossX + halfSpan);
+        }
+
+        // Both bounds are clamped to the tile, so they are non-negative.
+        // Spans are widened to whole groups of four pixels, which stay
+        // inside the tile as the tile origin is a multiple of four.
+        int x = static_cast<int>(spanMin) & ~3;
+        const int xEnd = std::min((ceilToInt(spanMax) + 3) & ~3, tile.x1);
+        ImU32 *row = tile.pixels
+            + static_cast<size_t>(y - tile.y0) * tile.stride - tile.x0;
+
+#ifdef FRIIMGUI_RASTERIZER_SSE2
+        const __m128 ry = _mm_set1_ps(y + 0.5f - line.y0);
+        const __m128 ryDy = _mm_mul_ps(ry, dy);
+
+        for (; x + 4 <= xEnd; x += 4) {
+            // distance of four pixel centers to the segment, the approximate
+            // reciprocal square root is accurate enough for coverage
+            const __m128 px
+                = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets);
+            const __m128 rx = _mm_sub_ps(px, x0);
+            __m128 t = _mm_mul_ps(
+                _mm_add_ps(_mm_mul_ps(rx, dx), ryDy),
+                invLengthSq
+            );
+            t = _mm_min_ps(_mm_max_ps(t, zero), one);
+            const __m128 ex = _mm_sub_ps(rx, _mm_mul_ps(t, dx));
+            const __m128 ey = _mm_sub_ps(ry, _mm_mul_ps(t, dy));
+            const __m128 distSq = _mm_max_ps(
+                _mm_add_ps(_mm_mul_ps(ex, ex), _mm_mul_ps(ey, ey)),
+                epsilon
+            );
+            const __m128 dist = _mm_mul_ps(distSq, _mm_rsqrt_ps(distSq));
+            const __m128 cov
+                = _mm_min_ps(_mm_max_ps(_mm_sub_ps(radius, dist), zero), one);
+
+            // per pixel alpha in [0, 256] replicated over the four channels
+            const __m128i alpha32 = _mm_cvtps_epi32(_mm_mul_ps(cov, alphaScale));
+            const __m128i alpha16 = _mm_packs_epi32(alpha32, alpha32);
+            const __m128i alphaPairs = _mm_unpacklo_epi16(alpha16, alpha16);
+            const __m128i alphaLo = _mm_unpacklo_epi32(alphaPairs, alphaPairs);
+            const __m128i alphaHi = _mm_unpackhi_epi32(alphaPairs, alphaPairs);
+
+            __m128i *dstPtr = reinterpret_cast<__m128i *>(row + x);
+            const __m128i dst = _mm_loadu_si128(dstPtr);
+            const __m128i dstLo = _mm_unpacklo_epi8(dst, zeroi);
+            const __m128i dstHi = _mm_unpackhi_epi8(dst, zeroi);
+
+            const __m128i outLo = _mm_srli_epi16(
+                _mm_add_epi16(
+                    _mm_mullo_epi16(src16, alphaLo),
+                    _mm_mullo_epi16(dstLo, _mm_sub_epi16(full16, alphaLo))
+                ),
+                8
+            );
+            const __m128i outHi = _mm_srli_epi16(
+                _mm_add_epi16(
+                    _mm_mullo_epi16(src16, alphaHi),
+                    _mm_mullo_epi16(dstHi, _mm_sub_epi16(full16, alphaHi))
+                ),
+                8
+            );
+            _mm_storeu_si128(dstPtr, _mm_packus_epi16(outLo, outHi));
+        }
+#endif
+
+        if (x < xEnd) {
+            blendLineSpan(row + x, x, xEnd, y + 0.5f, line);
+        }
+    }
+}
+
+} // namespace
+
+// ==================================================
+
+Bitmap Bitmap::loadFromFile(const std::filesystem::path &fileName) {
+    int w, h, comp;
+    unsigned char *data
+        = stbi_load(fileName.string().c_str(), &w, &h, &comp, 4);
+    if (! data) {
+        throw std::runtime_error(
+            "Failed to load image from: " + fileName.string()
+        );
+    }
+
+    Bitmap result(w, h);
+    std::copy_n(
+        data,
+        static_cast<size_t>(w) * h * 4,
+        reinterpret_cast<unsigned char *>(result.m_pixels.data())
+    );
+    stbi_image_free(data);
+
+    return result;
+}
+
+Bitmap::Bitmap(int width, int height, ImU32 clearColor) :
+    m_width(width),
+    m_height(height),
+    m_pixels(static_cast<size_t>(width) * height, clearColor) {
+}
+
+int Bitmap::getWidth() const {
+    return m_width;
+}
+
+int Bitmap::getHeight() const {
+    return m_height;
+}
+
+ImU32 *Bitmap::getPixels() {
+    return m_pixels.data();
+}
+
+const ImU32 *Bitmap::getPixels() const {
+    return m_pixels.data();
+}
+
+void Bitmap::clear(ImU32 color) {
+    std::fill(m_pixels.begin(), m_pixels.end(), color);
+}
+
+void Bitmap::savePng(const std::filesystem::path &fileName) const {
+    const int ok = stbi_write_png(
+        fileName.string().c_str(),
+        m_width,
+        m_height,
+        4,
+        m_pixels.data(),
+        m_width * 4
+    );
+    if (! ok) {
+        throw std::runtime_error(
+            "Failed to write image to: " + fileName.string()
+        );
+    }
+}
+
+// ==================================================
+
+Rasterizer::Rasterizer(int width, int height, int tileSize) :
+    m_width(width),
+    m_height(height),
+    m_tileSize((tileSize + 3) & ~3),
+    m_tilesX((width + m_tileSize - 1) / m_tileSize),
+    m_tilesY((height + m_tileSize - 1) / m_tileSize),
+    m_bins(static_cast<size_t>(m_tilesX) * m_tilesY),
+    m_sprites() {
+}
+
+void Rasterizer::addLine(const ImVec4 &line, ImU32 color, float thickness) {
+    binLine({line, color, thickness / 2 + 0.5f});
+}
+
+void Rasterizer::addImage(
+    const Bitmap &image,
+    const Transformation &transformation
+) {
+    // Same placement as Image::draw with the canvas origin at [0, 0]
+    Region imageRegion = Region::createAtPosCenter(
+        0,
+        0,
+        image.getWidth(),
+        image.getHeight()
+    );
+    imageRegion.transformThis(transformation.getMatrix());
+
+    m_sprites.push_back({&image, imageRegion});
+}
+
+void Rasterizer::clear() {
+    m_sprites.clear();
+    // Large bins are freed rather than kept for the next pass, otherwise
+    // rendering in passes would hold the largest bin of every tile
+    for (std::vector<Line> &bin : m_bins) {
+        if (bin.capacity() > k_keptBinLines) {
+            std::vector<Line>().swap(bin);
+        } else {
+            bin.clear();
+        }
+    }
+}
+
+void Rasterizer::render(Bitmap &target, unsigned threadCount) const {
+    if (target.getWidth() != m_width || target.getHeight() != m_height) {
+        throw std::invalid_argument("Target bitmap size does not match");
+    }
+
+    const int tileCount = m_tilesX * m_tilesY;
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = std::min<unsigned>(threadCount, tileCount);
+
+    std::atomic<int> nextTile = 0;
+    auto worker = [&]() {
+        std::vector<ImU32> scratch(static_cast<size_t>(m_tileSize) * m_tileSize);
+        for (int tile = nextTile++; tile < tileCount; tile = nextTile++) {
+            renderTile(target, tile, scratch.data());
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < threadCount; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+void Rasterizer::binLine(const Line &line) {
+    // Lines are copied into every bin they touch, so that each tile streams
+    // through its own lines instead of gathering them from one big array
+    const ImVec4 &p = line.points;
+
+    const float minX = std::min(p.x, p.z) - line.radius;
+    const float minY = std::min(p.y, p.w) - line.radius;
+    const float maxX = std::max(p.x, p.z) + line.radius;
+    const float maxY = std::max(p.y, p.w) + line.radius;
+    if (maxX < 0 || maxY < 0 || minX >= m_width || minY >= m_height) {
+        return;
+    }
+
+    const int tx0 = std::max(0, static_cast<int>(minX) / m_tileSize);
+    const int ty0 = std::max(0, static_cast<int>(minY) / m_tileSize);
+    const int tx1 = std::min(m_tilesX - 1, static_cast<int>(maxX) / m_tileSize);
+    const int ty1 = std::min(m_tilesY - 1, static_cast<int>(maxY) / m_tileSize);
+
+    // Long lines only go to tiles they actually cross: the tile rectangle
+    // must reach the line within the line radius along the line normal
+    const float dx = p.z - p.x;
+    const float dy = p.w - p.y;
+    const float length = std::sqrt(dx * dx + dy * dy);
+    const bool testNormal = length > 0 && (tx0 != tx1 || ty0 != ty1);
+    const float nx = testNormal ? -dy / length : 0;
+    const float ny = testNormal ? dx / length : 0;
+    const float half = m_tileSize / 2.0f;
+    const float reach = line.radius + half * (std::fabs(nx) + std::fabs(ny));
+
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            if (testNormal) {
+                const float cx = tx * m_tileSize + half - p.x;
+                const float cy = ty * m_tileSize + half - p.y;
+                if (std::fabs(cx * nx + cy * ny) > reach) {
+                    continue;
+                }
+            }
+            m_bins[static_cast<size_t>(ty) * m_tilesX + tx].push_back(line);
+        }
+    }
+}
+
+void Rasterizer::renderTile(
+    Bitmap &target,
+    int tileIndex,
+    ImU32 *scratch
+) const {
+    // Nothing to composite, the target keeps its pixels
+    if (m_bins[tileIndex].empty() && m_sprites.empty()) {
+        return;
+    }
+
+    const int tileX0 = (tileIndex % m_tilesX) * m_tileSize;
+    const int tileY0 = (tileIndex / m_tilesX) * m_tileSize;
+    const int tileX1 = std::min(tileX0 + m_tileSize, m_width);
+    const int tileY1 = std::min(tileY0 + m_tileSize, m_height);
+    const int tileWidth = tileX1 - tileX0;
+
+    // The tile is rendered in a contiguous buffer, rows of the target are
+    // too far apart and map into the same few cache sets
+    ImU32 *pixels = target.getPixels();
+    for (int y = tileY0; y < tileY1; ++y) {
+        std::copy_n(
+            pixels + static_cast<size_t>(y) * m_width + tileX0,
+            tileWidth,
+            scratch + static_cast<size_t>(y - tileY0) * m_tileSize
+        );
+    }
+
+    const TileTarget tile
+        = {scratch, m_tileSize, tileX0, tileY0, tileX1, tileY1};
+    for (const Line &line : m_bins[tileIndex]) {
+        const ImVec4 &p = line.points;
+
+        LineSetup setup;
+        setup.x0 = p.x;
+        setup.y0 = p.y;
+        setup.dx = p.z - p.x;
+        setup.dy = p.w - p.y;
+        const float lengthSq = setup.dx * setup.dx + setup.dy * setup.dy;
+        setup.invLengthSq = lengthSq > 0 ? 1.0f / lengthSq : 0.0f;
+        setup.radius = line.radius;
+        setup.srcAlpha = ((line.color >> IM_COL32_A_SHIFT) & 0xFF) / 255.0f;
+        setup.color = line.color | (0xFFu << IM_COL32_A_SHIFT);
+
+        blendLine(tile, setup);
+    }
+
+    for (const Sprite &sprite : m_sprites) {
+        const Region &region = sprite.region;
+        const ImVec2 &o = region.getP0();
+        const ImVec2 u = {region.getP1().x - o.x, region.getP1().y - o.y};
+        const ImVec2 v = {region.getP3().x - o.x, region.getP3().y - o.y};
+        const float det = u.x * v.y - u.y * v.x;
+        if (det == 0) {
+            continue;
+        }
+
+        const float minX = std::min({o.x, region.getP1().x, region.getP2().x, region.getP3().x});
+        const float minY = std::min({o.y, region.getP1().y, region.getP2().y, region.getP3().y});
+        const float maxX = std::max({o.x, region.getP1().x, region.getP2().x, region.getP3().x});
+        const float maxY = std::max({o.y, region.getP1().y, region.getP2().y, region.getP3().y});
+        const int x0 = std::max(tileX0, static_cast<int>(std::floor(minX)));
+        const int y0 = std::max(tileY0, static_cast<int>(std::floor(minY)));
+        const int x1 = std::min(tileX1, static_cast<int>(std::ceil(maxX)));
+        const int y1 = std::min(tileY1, static_cast<int>(std::ceil(maxY)));
+
+        const Bitmap &image = *sprite.image;
+        const ImU32 *texels = image.getPixels();
+        for (int y = y0; y < y1; ++y) {
+            ImU32 *row = scratch + static_cast<size_t>(y - tileY0) * m_tileSize - tileX0;
+            for (int x = x0; x < x1; ++x) {
+                // Inverse of the affine map from the unit square to the quad
+                const float qx = x + 0.5f - o.x;
+                const float qy = y + 0.5f - o.y;
+                const float s = (qx * v.y - qy * v.x) / det;
+                const float t = (u.x * qy - u.y * qx) / det;
+                if (s < 0 || s >= 1 || t < 0 || t >= 1) {
+                    continue;
+                }
+
+                const int tx = static_cast<int>(s * image.getWidth());
+                const int ty = static_cast<int>(t * image.getHeight());
+                const ImU32 texel
+                    = texels[static_cast<size_t>(ty) * image.getWidth() + tx];
+                const int alpha = static_cast<int>((texel >> IM_COL32_A_SHIFT) & 0xFF);
+                if (alpha > 0) {
+                    row[x] = blendPixel(row[x], texel, alpha + (alpha >> 7));
+                }
+            }
+        }
+    }
+
+    for (int y = tileY0; y < tileY1; ++y) {
+        std::copy_n(
+            scratch + static_cast<size_t>(y - tileY0) * m_tileSize,
+            tileWidth,
+            pixels + static_cast<size_t>(y) * m_width + tileX0
+        );
+    }
+}
+
+} // namespace friimgui
@@ -0,0 +1,84 @@
+#ifndef FRIIMGUI_RASTERIZER_HPP
+#define FRIIMGUI_RASTERIZER_HPP
+
+#include "types.hpp"
+
+#include <imgui/imgui.h>
+
+#include <filesystem>
+#include <vector>
+
+namespace friimgui {
+
+// RGBA8 pixel buffer living in main memory, pixels use the ImU32 layout.
+class Bitmap {
+public:
+    static Bitmap loadFromFile(const std::filesystem::path &fileName);
+
+    Bitmap(int width, int height, ImU32 clearColor = IM_COL32_BLACK);
+
+    int getWidth() const;
+    int getHeight() const;
+    ImU32 *getPixels();
+    const ImU32 *getPixels() const;
+
+    void clear(ImU32 color);
+    void savePng(const std::filesystem::path &fileName) const;
+
+private:
+    int m_width;
+    int m_height;
+    std::vector<ImU32> m_pixels;
+};
+
+// ==================================================
+
+// CPU renderer for anti-aliased lines and sprites, usable without any window
+// or GL context. Primitives are binned into square tiles which are then
+// rendered independently, possibly by several threads. The tile size is
+// rounded up to a multiple of four pixels.
+//
+// A line is copied into every bin it touches. Rendering composites onto the
+// pixels of the target, so many lines are better rendered in passes of a
+// bounded size, clearing the rasterizer in between.
+class Rasterizer {
+public:
+    Rasterizer(int width, int height, int tileSize = 64);
+
+    void addLine(const ImVec4 &line, ImU32 color, float thickness = 1.0f);
+    void addImage(const Bitmap &image, const Transformation &transformation);
+    void clear();
+
+    // Lines are composited in submission order, sprites are drawn over them.
+    void render(Bitmap &target, unsigned threadCount = 0) const;
+
+private:
+    struct Line {
+        ImVec4 points;
+        ImU32 color;
+        float radius;
+    };
+
+    struct Sprite {
+        const Bitmap *image;
+        Region region;
+    };
+
+    static constexpr size_t k_keptBinLines = 64;
+
+    void binLine(const Line &line);
+    void renderTile(Bitmap &target, int tileIndex, ImU32 *scratch) const;
+
+    int m_width;
+    int m_height;
+    int m_tileSize;
+    int m_tilesX;
+    int m_tilesY;
+
+    std::vector<std::vector<Line>> m_bins;
+    std::vector<Sprite> m_sprites;
+};
+
+} // namespace friimgui
+
+#endif
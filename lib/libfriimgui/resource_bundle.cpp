@@ -0,0 +1,279 @@
+#include "resource_bundle.hpp"
+#include "buffered_writer.hpp"
+
+#include <stb/stb_image.h>
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace friimgui {
+
+namespace {
+
+// Layout: header, index entries, names, pixel data. Numbers are little
+// endian, every image starts at a multiple of the alignment.
+constexpr char k_magic[8] = {'F', 'R', 'I', 'B', 'U', 'N', 'D', 'L'};
+constexpr std::uint32_t k_version = 1;
+constexpr size_t k_headerSize = 16;
+constexpr size_t k_entrySize = 32;
+constexpr size_t k_dataAlignment = 64;
+
+void writeLittleEndian(
+    BufferedWriter &writer,
+    std::uint64_t value,
+    int byteCount
+) {
+    char bytes[8];
+    for (int i = 0; i < byteCount; ++i) {
+        bytes[i] = static_cast<char>(value >> (8 * i));
+    }
+    writer.write(std::string_view(bytes, byteCount));
+}
+
+std::uint64_t readLittleEndian(const unsigned char *data, int byteCount) {
+    std::uint64_t value = 0;
+    for (int i = byteCount - 1; i >= 0; --i) {
+        value = value << 8 | data[i];
+    }
+    return value;
+}
+
+size_t alignUp(size_t value) {
+    return (value + k_dataAlignment - 1) / k_dataAlignment * k_dataAlignment;
+}
+
+} // namespace
+
+void ResourceBundle::write(
+    const std::filesystem::path &fileName,
+    const std::vector<std::pair<std::string, std::filesystem::path>> &images
+) {
+    struct Entry {
+        size_t dataOffset;
+        size_t nameOffset;
+        int width;
+        int height;
+    };
+
+    // Sizes come from the headers, so the index can be written first
+    std::vector<Entry> entries;
+    size_t namesOffset = k_headerSize + images.size() * k_entrySize;
+    size_t offset = namesOffset;
+    for (const auto &[name, path] : images) {
+        Entry entry = {0, offset, 0, 0};
+        int comp;
+        const std::string file = path.string();
+        if (! stbi_info(file.c_str(), &entry.width, &entry.height, &comp)) {
+            throw std::runtime_error("Failed to load image from: " + file);
+        }
+        offset += name.size();
+        entries.push_back(entry);
+    }
+    for (Entry &entry : entries) {
+        offset = alignUp(offset);
+        entry.dataOffset = offset;
+        offset += static_cast<size_t>(entry.width) * entry.height * 4;
+    }
+
+    BufferedWriter writer(fileName);
+    writer.write(std::string_view(k_magic, sizeof(k_magic)));
+    writeLittleEndian(writer, k_version, 4);
+    writeLittleEndian(writer, images.size(), 4);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        writeLittleEndian(writer, entries[i].dataOffset, 8);
+        writeLittleEndian(writer, entries[i].nameOffset, 8);
+        writeLittleEndian(writer, images[i].first.size(), 4);
+        writeLittleEndian(writer, entries[i].width, 4);
+        writeLittleEndian(writer, entries[i].height, 4);
+        writeLittleEndian(writer, 0, 4);
+    }
+    for (const auto &[name, path] : images) {
+        writer.write(name);
+    }
+
+    offset = namesOffset;
+    for (const auto &[name, path] : images) {
+        offset += name.size();
+    }
+    for (size_t i = 0; i < entries.size(); ++i) {
+        for (; offset < entries[i].dataOffset; ++offset) {
+            writer.write('\0');
+        }
+
+        int w, h, comp;
+        const std::string path = images[i].second.string();
+        unsigned char *data = stbi_load(path.c_str(), &w, &h, &comp, 4);
+        if (! data || w != entries[i].width || h != entries[i].height) {
+            stbi_image_free(data);
+            throw std::runtime_error("Failed to load image from: " + path);
+        }
+
+        const size_t size = static_cast<size_t>(w) * h * 4;
+        writer.write(
+            std::string_view(reinterpret_cast<const char *>(data), size)
+        );
+        stbi_image_free(data);
+        offset += size;
+    }
+    writer.flush();
+}
+
+ResourceBundle::ResourceBundle(const std::filesystem::path &fileName) :
+    m_data(nullptr),
+    m_size(0),
+    m_images() {
+#ifdef _WIN32
+    HANDLE file = CreateFileW(
+        fileName.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error(
+            "Failed to open resource bundle: " + fileName.string()
+        );
+    }
+
+    LARGE_INTEGER size;
+    HANDLE mapping = nullptr;
+    if (GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        mapping
+            = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    }
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        throw std::runtime_error(
+            "Failed to map resource bundle: " + fileName.string()
+        );
+    }
+
+    // The view keeps the mapping alive
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (view == nullptr) {
+        throw std::runtime_error(
+            "Failed to map resource bundle: " + fileName.string()
+        );
+    }
+    m_data = static_cast<const unsigned char *>(view);
+    m_size = static_cast<size_t>(size.QuadPart);
+#else
+    const int file = open(fileName.c_str(), O_RDONLY);
+    if (file < 0) {
+        throw std::runtime_error(
+            "Failed to open resource bundle: " + fileName.string()
+        );
+    }
+
+    struct stat status;
+    void *view = MAP_FAILED;
+    if (fstat(file, &status) == 0 && status.st_size > 0) {
+        view = mmap(
+            nullptr,
+            static_cast<size_t>(status.st_size),
+            PROT_READ,
+            MAP_SHARED,
+            file,
+            0
+        );
+    }
+    close(file);
+    if (view == MAP_FAILED) {
+        throw std::runtime_error(
+            "Failed to map resource bundle: " + fileName.string()
+        );
+    }
+    m_data = static_cast<const unsigned char *>(view);
+    m_size = static_cast<size_t>(status.st_size);
+#endif
+
+    try {
+        parse(fileName);
+    } catch (...) {
+        unmap();
+        throw;
+    }
+}
+
+ResourceBundle::~ResourceBundle() {
+    unmap();
+}
+
+const std::unordered_map<std::string, ResourceBundle::Image> &
+ResourceBundle::getImages() const {
+    return m_images;
+}
+
+void ResourceBundle::unmap() {
+    if (m_data == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+#else
+    munmap(const_cast<unsigned char *>(m_data), m_size);
+#endif
+    m_data = nullptr;
+}
+
+void ResourceBundle::parse(const std::filesystem::path &fileName) {
+    const std::runtime_error invalid(
+        "Invalid resource bundle: " + fileName.string()
+    );
+
+    if (m_size < k_headerSize
+        || std::memcmp(m_data, k_magic, sizeof(k_magic)) != 0
+        || readLittleEndian(m_data + 8, 4) != k_version) {
+        throw invalid;
+    }
+
+    const size_t count = readLittleEndian(m_data + 12, 4);
+    if ((m_size - k_headerSize) / k_entrySize < count) {
+        throw invalid;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        const unsigned char *entry = m_data + k_headerSize + i * k_entrySize;
+        const std::uint64_t dataOffset = readLittleEndian(entry, 8);
+        const std::uint64_t nameOffset = readLittleEndian(entry + 8, 8);
+        const std::uint64_t nameLength = readLittleEndian(entry + 16, 4);
+        const std::uint64_t width = readLittleEndian(entry + 20, 4);
+        const std::uint64_t height = readLittleEndian(entry + 24, 4);
+
+        const std::uint64_t dataSize = width * height * 4;
+        if (nameOffset > m_size || nameLength > m_size - nameOffset
+            || dataOffset > m_size || dataSize > m_size - dataOffset) {
+            throw invalid;
+        }
+
+        const std::string name(
+            reinterpret_cast<const char *>(m_data + nameOffset),
+            nameLength
+        );
+        m_images[name] = {
+            static_cast<int>(width),
+            static_cast<int>(height),
+            m_data + dataOffset
+        };
+    }
+}
+
+} // namespace friimgui
@@ -0,0 +1,51 @@
+#ifndef FRIIMGUI_RESOURCE_BUNDLE_HPP
+#define FRIIMGUI_RESOURCE_BUNDLE_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace friimgui {
+
+// Decoded RGBA8 images packed into a single file with an index of their
+// names. The file is read through a read-only memory mapping, the pixels
+// of an image point straight into it and stay valid while the bundle
+// exists.
+class ResourceBundle {
+public:
+    struct Image {
+        int width;
+        int height;
+        const unsigned char *pixels;
+    };
+
+    // Decodes the given files and stores them under the given names.
+    static void write(
+        const std::filesystem::path &fileName,
+        const std::vector<std::pair<std::string, std::filesystem::path>>
+            &images
+    );
+
+    explicit ResourceBundle(const std::filesystem::path &fileName);
+    ~ResourceBundle();
+
+    ResourceBundle(const ResourceBundle &) = delete;
+    ResourceBundle &operator= (const ResourceBundle &) = delete;
+
+    const std::unordered_map<std::string, Image> &getImages() const;
+
+private:
+    void unmap();
+    void parse(const std::filesystem::path &fileName);
+
+    const unsigned char *m_data;
+    size_t m_size;
+    std::unordered_map<std::string, Image> m_images;
+};
+
+} // namespace friimgui
+
+#endif
@@ -0,0 +1,316 @@
+#include "sprite_batch.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+namespace friimgui {
+
+namespace {
+
+const char *k_vertexShader = R"(#version 330 core
+layout(location = 0) in vec2 aCorner;
+layout(location = 1) in vec4 aSizeTranslation;
+layout(location = 2) in vec4 aLinear;
+layout(location = 3) in vec4 aUv;
+
+uniform mat4 uProjection;
+
+out vec2 vUv;
+
+void main() {
+    vec2 p = (aCorner * 2.0 - 1.0) * aSizeTranslation.xy;
+    p = mat2(aLinear) * p + aSizeTranslation.zw;
+
+    gl_Position = uProjection * vec4(p, 0.0, 1.0);
+    vUv = mix(aUv.xy, aUv.zw, aCorner);
+}
+)";
+
+const char *k_fragmentShader = R"(#version 330 core
+uniform sampler2D uTexture;
+
+in vec2 vUv;
+out vec4 oColor;
+
+void main() {
+    oColor = texture(uTexture, vUv);
+}
+)";
+
+// Triangle strip of the sprite corners, (0, 0) is the top left one.
+const float k_corners[] = {0, 0, 1, 0, 0, 1, 1, 1};
+
+GLuint compileShader(GLenum type, const char *source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        char log[512];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        std::cerr << "Failed to compile sprite shader: " << log << "\n";
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+const void *bufferOffset(size_t offset) {
+    return reinterpret_cast<const void *>(static_cast<std::uintptr_t>(offset));
+}
+
+} // namespace
+
+SpriteBatch &SpriteBatch::getInstance() {
+    static SpriteBatch instance;
+    return instance;
+}
+
+void SpriteBatch::beginFrame() {
+    if (! m_initialized) {
+        m_initialized = true;
+        m_supported = initialize();
+    }
+
+    m_instances.clear();
+    m_runs.clear();
+    m_uploaded = false;
+    m_lastList = nullptr;
+}
+
+void SpriteBatch::release() {
+    if (m_supported) {
+        glDeleteProgram(m_program);
+        glDeleteVertexArrays(1, &m_vertexArray);
+        glDeleteBuffers(1, &m_cornerBuffer);
+        glDeleteBuffers(1, &m_instanceBuffer);
+    }
+    m_initialized = false;
+    m_supported = false;
+}
+
+bool SpriteBatch::add(
+    ImDrawList *drawList,
+    GLuint texture,
+    ImVec2 uv0,
+    ImVec2 uv1,
+    ImVec2 size,
+    const Transformation &transformation,
+    ImVec2 offset
+) {
+    if (! m_supported) {
+        return false;
+    }
+
+    const AffineTransform &matrix = transformation.getMatrix();
+    m_instances.push_back({
+        ImVec2(size.x / 2, size.y / 2),
+        ImVec2(matrix.tx + offset.x, matrix.ty + offset.y),
+        {matrix.a, matrix.b, matrix.c, matrix.d},
+        uv0,
+        uv1
+    });
+
+    const ImVec2 clipMin = drawList->GetClipRectMin();
+    const ImVec2 clipMax = drawList->GetClipRectMax();
+    const bool extendsRun = drawList == m_lastList
+                         && drawList->CmdBuffer.Size == m_lastCmdCount
+                         && drawList->IdxBuffer.Size == m_lastIdxCount
+                         && clipMin.x == m_lastClipMin.x
+                         && clipMin.y == m_lastClipMin.y
+                         && clipMax.x == m_lastClipMax.x
+                         && clipMax.y == m_lastClipMax.y
+                         && m_runs.back().texture == texture;
+    if (extendsRun) {
+        ++m_runs.back().count;
+        return true;
+    }
+
+    m_runs.push_back({texture, m_instances.size() - 1, 1});
+    drawList->AddCallback(
+        &SpriteBatch::renderCallback,
+        reinterpret_cast<void *>(static_cast<std::intptr_t>(m_runs.size() - 1))
+    );
+    drawList->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
+
+    m_lastList = drawList;
+    m_lastCmdCount = drawList->CmdBuffer.Size;
+    m_lastIdxCount = drawList->IdxBuffer.Size;
+    m_lastClipMin = clipMin;
+    m_lastClipMax = clipMax;
+    return true;
+}
+
+void SpriteBatch::renderCallback(
+    const ImDrawList *drawList,
+    const ImDrawCmd *cmd
+) {
+    (void)drawList;
+    SpriteBatch &batch = getInstance();
+    const size_t runIndex = static_cast<size_t>(
+        reinterpret_cast<std::intptr_t>(cmd->UserCallbackData)
+    );
+    batch.renderRun(batch.m_runs[runIndex], *cmd);
+}
+
+SpriteBatch::SpriteBatch() :
+    m_instances(),
+    m_runs(),
+    m_uploaded(false),
+    m_lastList(nullptr),
+    m_lastCmdCount(0),
+    m_lastIdxCount(0),
+    m_lastClipMin(),
+    m_lastClipMax(),
+    m_initialized(false),
+    m_supported(false),
+    m_program(0),
+    m_projectionLocation(-1),
+    m_textureLocation(-1),
+    m_vertexArray(0),
+    m_cornerBuffer(0),
+    m_instanceBuffer(0) {
+}
+
+bool SpriteBatch::initialize() {
+    if (! GLAD_GL_VERSION_3_3) {
+        return false;
+    }
+
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, k_vertexShader);
+    GLuint fragmentShader
+        = compileShader(GL_FRAGMENT_SHADER, k_fragmentShader);
+    if (vertexShader == 0 || fragmentShader == 0) {
+        glDeleteShader(vertexShader);
+        glDeleteShader(fragmentShader);
+        return false;
+    }
+
+    m_program = glCreateProgram();
+    glAttachShader(m_program, vertexShader);
+    glAttachShader(m_program, fragmentShader);
+    glLinkProgram(m_program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint status = GL_FALSE;
+    glGetProgramiv(m_program, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        char log[512];
+        glGetProgramInfoLog(m_program, sizeof(log), nullptr, log);
+        std::cerr << "Failed to link sprite shader: " << log << "\n";
+        glDeleteProgram(m_program);
+        return false;
+    }
+    m_projectionLocation = glGetUniformLocation(m_program, "uProjection");
+    m_textureLocation = glGetUniformLocation(m_program, "uTexture");
+
+    // Keep the bindings of the ImGui renderer intact
+    GLint lastVertexArray, lastArrayBuffer;
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &lastVertexArray);
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &lastArrayBuffer);
+
+    glGenVertexArrays(1, &m_vertexArray);
+    glGenBuffers(1, &m_cornerBuffer);
+    glGenBuffers(1, &m_instanceBuffer);
+    glBindVertexArray(m_vertexArray);
+
+    glBindBuffer(GL_ARRAY_BUFFER, m_cornerBuffer);
+    glBufferData(
+        GL_ARRAY_BUFFER,
+        sizeof(k_corners),
+        k_corners,
+        GL_STATIC_DRAW
+    );
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+    for (GLuint location = 1; location <= 3; ++location) {
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+
+    glBindVertexArray(lastVertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, lastArrayBuffer);
+    return true;
+}
+
+void SpriteBatch::renderRun(const Run &run, const ImDrawCmd &cmd) {
+    // All instances of the frame are uploaded by its first run
+    glBindBuffer(GL_ARRAY_BUFFER, m_instanceBuffer);
+    if (! m_uploaded) {
+        glBufferData(
+            GL_ARRAY_BUFFER,
+            m_instances.size() * sizeof(Instance),
+            m_instances.data(),
+            GL_STREAM_DRAW
+        );
+        m_uploaded = true;
+    }
+
+    const ImDrawData *drawData = ImGui::GetDrawData();
+    const ImVec2 pos = drawData->DisplayPos;
+    const ImVec2 size = drawData->DisplaySize;
+    const ImVec2 scale = drawData->FramebufferScale;
+
+    // Callbacks get no scissor from the ImGui renderer
+    const float clipMinX = (cmd.ClipRect.x - pos.x) * scale.x;
+    const float clipMinY = (cmd.ClipRect.y - pos.y) * scale.y;
+    const float clipMaxX = (cmd.ClipRect.z - pos.x) * scale.x;
+    const float clipMaxY = (cmd.ClipRect.w - pos.y) * scale.y;
+    if (clipMaxX <= clipMinX || clipMaxY <= clipMinY) {
+        return;
+    }
+    glScissor(
+        static_cast<GLint>(clipMinX),
+        static_cast<GLint>(size.y * scale.y - clipMaxY),
+        static_cast<GLsizei>(clipMaxX - clipMinX),
+        static_cast<GLsizei>(clipMaxY - clipMinY)
+    );
+
+    // Same orthographic projection as the ImGui renderer uses
+    const float l = pos.x;
+    const float r = pos.x + size.x;
+    const float t = pos.y;
+    const float b = pos.y + size.y;
+    const float projection[16] = {
+        2.0f / (r - l),    0.0f,              0.0f,  0.0f,
+        0.0f,              2.0f / (t - b),    0.0f,  0.0f,
+        0.0f,              0.0f,              -1.0f, 0.0f,
+        (r + l) / (l - r), (t + b) / (b - t), 0.0f,  1.0f,
+    };
+
+    glUseProgram(m_program);
+    glUniformMatrix4fv(m_projectionLocation, 1, GL_FALSE, projection);
+    glUniform1i(m_textureLocation, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, run.texture);
+
+    glBindVertexArray(m_vertexArray);
+    const size_t base = run.first * sizeof(Instance);
+    auto setAttribute = [base](GLuint location, GLint size, size_t offset) {
+        glVertexAttribPointer(
+            location,
+            size,
+            GL_FLOAT,
+            GL_FALSE,
+            sizeof(Instance),
+            bufferOffset(base + offset)
+        );
+    };
+    setAttribute(1, 4, offsetof(Instance, halfSize));
+    setAttribute(2, 4, offsetof(Instance, linear));
+    setAttribute(3, 4, offsetof(Instance, uv0));
+
+    glDrawArraysInstanced(
+        GL_TRIANGLE_STRIP,
+        0,
+        4,
+        static_cast<GLsizei>(run.count)
+    );
+}
+
+} // namespace friimgui
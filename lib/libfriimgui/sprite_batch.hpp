@@ -0,0 +1,95 @@
+#ifndef FRIIMGUI_SPRITE_BATCH_HPP
+#define FRIIMGUI_SPRITE_BATCH_HPP
+
+#include "types.hpp"
+
+#include <glad/glad.h>
+
+#include <imgui/imgui.h>
+
+#include <vector>
+
+namespace friimgui {
+
+// Renders the sprites of a frame with instanced GL calls. Sprites added one
+// after another to the same draw list with the same texture form a run,
+// which becomes a single draw list callback drawing all of them at once.
+// Every sprite carries the matrix of its transformation, which the vertex
+// shader applies to the corners.
+//
+// Without OpenGL 3.3 add() refuses every sprite and the caller is expected
+// to draw it by itself.
+class SpriteBatch {
+public:
+    static SpriteBatch &getInstance();
+
+    SpriteBatch(const SpriteBatch &) = delete;
+    SpriteBatch &operator= (const SpriteBatch &) = delete;
+
+    // Called outside of a frame, creates the GL objects on first use and
+    // forgets the sprites of the previous frame.
+    void beginFrame();
+
+    // Deletes the GL objects while their context still exists.
+    void release();
+
+    bool add(
+        ImDrawList *drawList,
+        GLuint texture,
+        ImVec2 uv0,
+        ImVec2 uv1,
+        ImVec2 size,
+        const Transformation &transformation,
+        ImVec2 offset
+    );
+
+private:
+    struct Instance {
+        ImVec2 halfSize;
+        ImVec2 translation;
+        float linear[4];
+        ImVec2 uv0;
+        ImVec2 uv1;
+    };
+
+    struct Run {
+        GLuint texture;
+        size_t first;
+        size_t count;
+    };
+
+    static void renderCallback(
+        const ImDrawList *drawList,
+        const ImDrawCmd *cmd
+    );
+
+    SpriteBatch();
+
+    bool initialize();
+    void renderRun(const Run &run, const ImDrawCmd &cmd);
+
+    std::vector<Instance> m_instances;
+    std::vector<Run> m_runs;
+    bool m_uploaded;
+
+    // Draw list state right after the last run was added, a sprite extends
+    // the run only if nothing else was drawn in between
+    const ImDrawList *m_lastList;
+    int m_lastCmdCount;
+    int m_lastIdxCount;
+    ImVec2 m_lastClipMin;
+    ImVec2 m_lastClipMax;
+
+    bool m_initialized;
+    bool m_supported;
+    GLuint m_program;
+    GLint m_projectionLocation;
+    GLint m_textureLocation;
+    GLuint m_vertexArray;
+    GLuint m_cornerBuffer;
+    GLuint m_instanceBuffer;
+};
+
+} // namespace friimgui
+
+#endif
@@ -0,0 +1,435 @@
+#include "texture_cache.hpp"
+
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace friimgui {
+
+namespace {
+
+// Border around every image on a page, filled with copies of the image edge
+// so linear filtering never picks up a neighbouring image.
+constexpr int k_padding = 1;
+
+} // namespace
+
+GLuint Texture::getId() const {
+    return m_id;
+}
+
+ImVec2 Texture::getUv0() const {
+    return m_uv0;
+}
+
+ImVec2 Texture::getUv1() const {
+    return m_uv1;
+}
+
+bool Texture::hasFailed() const {
+    return m_failed;
+}
+
+int Texture::getWidth() const {
+    return m_width;
+}
+
+int Texture::getHeight() const {
+    return m_height;
+}
+
+size_t Texture::getByteSize() const {
+    return static_cast<size_t>(m_width) * m_height * 4;
+}
+
+Texture::Texture(int width, int height) :
+    m_pixels(),
+    m_source(nullptr),
+    m_width(width),
+    m_height(height),
+    m_failed(false),
+    m_id(0),
+    m_uv0(0, 0),
+    m_uv1(0, 0) {
+}
+
+// ==================================================
+
+TextureCache &TextureCache::getInstance() {
+    static TextureCache instance;
+    return instance;
+}
+
+std::shared_ptr<const Texture> TextureCache::acquire(
+    const std::filesystem::path &fileName
+) {
+    const std::string key
+        = std::filesystem::weakly_canonical(fileName).generic_string();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(key);
+    if (it != m_entries.end()) {
+        if (std::shared_ptr<const Texture> handle = it->second.handle.lock()) {
+            ++m_hits;
+            return handle;
+        }
+    }
+
+    // Bundled pixels are ready for upload, other images are decoded in the
+    // background and only their header is read here
+    auto bundled = m_bundled.find(key);
+    int w, h, comp;
+    if (bundled != m_bundled.end()) {
+        w = bundled->second.width;
+        h = bundled->second.height;
+    } else if (! stbi_info(fileName.string().c_str(), &w, &h, &comp)) {
+        throw std::runtime_error(
+            "Failed to load image from: " + fileName.string()
+        );
+    }
+
+    Texture *texture = new Texture(w, h);
+    std::shared_ptr<const Texture> handle(
+        texture,
+        [this, key](const Texture *released) { release(key, released); }
+    );
+
+    const std::uint64_t serial = m_nextSerial++;
+    m_entries[key] = {texture, handle, serial};
+    ++m_misses;
+    ++m_pendingCount;
+
+    if (bundled != m_bundled.end()) {
+        m_decoded.push_back({key, serial, {}, bundled->second.pixels});
+        return handle;
+    }
+
+    if (! m_decoder) {
+        m_decoder = std::make_unique<ThreadPool>();
+    }
+    m_decoder->submit([this, key, fileName, serial] {
+        decode(key, fileName, serial);
+    });
+    return handle;
+}
+
+bool TextureCache::mountBundle(const std::filesystem::path &fileName) {
+    if (! std::filesystem::exists(fileName)) {
+        return false;
+    }
+    auto bundle = std::make_unique<ResourceBundle>(fileName);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto &[name, image] : bundle->getImages()) {
+        m_bundled[std::filesystem::weakly_canonical(name).generic_string()]
+            = image;
+    }
+    m_bundles.push_back(std::move(bundle));
+    return true;
+}
+
+void TextureCache::update() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // At least one image per call, so a large one cannot stall forever
+    size_t uploaded = 0;
+    while (! m_decoded.empty()
+           && (uploaded == 0 || uploaded < m_uploadBudget)) {
+        Decoded decoded = std::move(m_decoded.front());
+        m_decoded.pop_front();
+        --m_pendingCount;
+
+        uploaded += upload(decoded);
+    }
+
+    if (m_dirty && m_pendingCount == 0 && m_repacking.empty()) {
+        repack();
+    }
+
+    // Moving images to the new pages shares the budget with the uploads
+    while (! m_repacking.empty()
+           && (uploaded == 0 || uploaded < m_uploadBudget)) {
+        Texture *texture = m_repacking.back();
+        m_repacking.pop_back();
+
+        place(*texture);
+        uploaded += texture->getByteSize();
+    }
+    if (m_repacking.empty()) {
+        deletePages(m_retiredPages);
+    }
+}
+
+void TextureCache::setUploadBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_uploadBudget = bytes;
+}
+
+void TextureCache::releaseTextures() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    deletePages(m_pages);
+    deletePages(m_retiredPages);
+    m_repacking.clear();
+    for (auto &[key, entry] : m_entries) {
+        entry.texture->m_id = 0;
+    }
+    m_dirty = true;
+}
+
+TextureCacheStats TextureCache::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t residentBytes = 0;
+    for (const std::vector<Page> *pages : {&m_pages, &m_retiredPages}) {
+        for (const Page &page : *pages) {
+            residentBytes += static_cast<size_t>(page.size) * page.size * 4;
+        }
+    }
+    return {
+        m_hits,
+        m_misses,
+        m_entries.size(),
+        m_pendingCount,
+        m_pages.size() + m_retiredPages.size(),
+        residentBytes,
+        m_pixelBytes
+    };
+}
+
+TextureCache::TextureCache() :
+    m_mutex(),
+    m_entries(),
+    m_bundles(),
+    m_bundled(),
+    m_decoded(),
+    m_pendingCount(0),
+    m_nextSerial(0),
+    m_uploadBudget(k_defaultUploadBudget),
+    m_pages(),
+    m_retiredPages(),
+    m_repacking(),
+    m_dirty(false),
+    m_hits(0),
+    m_misses(0),
+    m_pixelBytes(0),
+    m_decoder() {
+}
+
+void TextureCache::decode(
+    const std::string &key,
+    const std::filesystem::path &fileName,
+    std::uint64_t serial
+) {
+    Decoded decoded = {key, serial, {}, nullptr};
+
+    int w, h, comp;
+    unsigned char *data
+        = stbi_load(fileName.string().c_str(), &w, &h, &comp, 4);
+    if (data) {
+        decoded.pixels.assign(data, data + static_cast<size_t>(w) * h * 4);
+        stbi_image_free(data);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_decoded.push_back(std::move(decoded));
+}
+
+void TextureCache::release(const std::string &key, const Texture *texture) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pixelBytes -= texture->m_pixels.size();
+    auto it = m_entries.find(key);
+    if (it != m_entries.end() && it->second.texture == texture) {
+        m_entries.erase(it);
+    }
+    std::erase(m_repacking, texture);
+    delete texture;
+
+    // Its space on the page is reclaimed by the next repack
+    m_dirty = true;
+}
+
+size_t TextureCache::upload(Decoded &decoded) {
+    // The texture may have been released while it was being decoded
+    auto it = m_entries.find(decoded.key);
+    if (it == m_entries.end() || it->second.serial != decoded.serial) {
+        return 0;
+    }
+
+    Texture &texture = *it->second.texture;
+    if (decoded.source != nullptr) {
+        texture.m_source = decoded.source;
+    } else if (decoded.pixels.size() == texture.getByteSize()) {
+        texture.m_pixels = std::move(decoded.pixels);
+        texture.m_source = texture.m_pixels.data();
+        m_pixelBytes += texture.m_pixels.size();
+    } else {
+        std::cerr << "Failed to decode image: " << decoded.key << "\n";
+        texture.m_failed = true;
+        return 0;
+    }
+
+    // A new page leaves the free space of the old ones unused until the
+    // next repack
+    if (! place(texture)) {
+        m_dirty = true;
+    }
+    return texture.getByteSize();
+}
+
+void TextureCache::repack() {
+    m_dirty = false;
+
+    // The old pages are drawn from until every image has been moved by
+    // update(), images are taken from the back of the list
+    deletePages(m_retiredPages);
+    m_retiredPages = std::move(m_pages);
+    m_pages.clear();
+
+    // Tallest first keeps the shelves of a page evenly filled
+    m_repacking.clear();
+    m_repacking.reserve(m_entries.size());
+    for (const auto &[key, entry] : m_entries) {
+        if (entry.texture->m_source != nullptr) {
+            m_repacking.push_back(entry.texture);
+        }
+    }
+    std::sort(
+        m_repacking.begin(),
+        m_repacking.end(),
+        [](const Texture *a, const Texture *b) {
+            return a->m_height != b->m_height ? a->m_height < b->m_height
+                                              : a->m_width < b->m_width;
+        }
+    );
+}
+
+bool TextureCache::place(Texture &texture) {
+    if (! m_pages.empty()
+        && placeOnPage(texture, static_cast<int>(m_pages.size()) - 1)) {
+        return true;
+    }
+    const bool first = m_pages.empty();
+    addPage(std::max(texture.m_width, texture.m_height) + 2 * k_padding);
+    placeOnPage(texture, static_cast<int>(m_pages.size()) - 1);
+    return first;
+}
+
+bool TextureCache::placeOnPage(Texture &texture, int pageIndex) {
+    Page &page = m_pages[pageIndex];
+    const int w = texture.m_width + 2 * k_padding;
+    const int h = texture.m_height + 2 * k_padding;
+
+    int x = page.cursorX;
+    int y = page.shelfY;
+    int shelfHeight = page.shelfHeight;
+    if (x + w > page.size) {
+        x = 0;
+        y += shelfHeight;
+        shelfHeight = 0;
+    }
+    if (x + w > page.size || y + h > page.size) {
+        return false;
+    }
+    page.cursorX = x + w;
+    page.shelfY = y;
+    page.shelfHeight = std::max(shelfHeight, h);
+
+    // The image goes up straight from its pixels, the padding is filled by
+    // uploading its edges once more. The row length lets GL step through
+    // whole rows of the source while copying only a part of each.
+    const int sx = texture.m_width - 1;
+    const int sy = texture.m_height - 1;
+    const int x0 = x + k_padding;
+    const int y0 = y + k_padding;
+    const int x1 = x0 + sx;
+    const int y1 = y0 + sy;
+    glBindTexture(GL_TEXTURE_2D, page.id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, texture.m_width);
+
+    uploadRect(texture, 0, 0, texture.m_width, texture.m_height, x0, y0);
+    for (int i = 1; i <= k_padding; ++i) {
+        uploadRect(texture, 0, 0, texture.m_width, 1, x0, y0 - i);
+        uploadRect(texture, 0, sy, texture.m_width, 1, x0, y1 + i);
+        uploadRect(texture, 0, 0, 1, texture.m_height, x0 - i, y0);
+        uploadRect(texture, sx, 0, 1, texture.m_height, x1 + i, y0);
+        for (int j = 1; j <= k_padding; ++j) {
+            uploadRect(texture, 0, 0, 1, 1, x0 - i, y0 - j);
+            uploadRect(texture, sx, 0, 1, 1, x1 + i, y0 - j);
+            uploadRect(texture, 0, sy, 1, 1, x0 - i, y1 + j);
+            uploadRect(texture, sx, sy, 1, 1, x1 + i, y1 + j);
+        }
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+    const float scale = 1.0f / page.size;
+    texture.m_id = page.id;
+    texture.m_uv0 = ImVec2((x + k_padding) * scale, (y + k_padding) * scale);
+    texture.m_uv1 = ImVec2(
+        (x + k_padding + texture.m_width) * scale,
+        (y + k_padding + texture.m_height) * scale
+    );
+    return true;
+}
+
+void TextureCache::uploadRect(
+    const Texture &texture,
+    int srcX,
+    int srcY,
+    int width,
+    int height,
+    int dstX,
+    int dstY
+) {
+    const size_t offset
+        = (static_cast<size_t>(srcY) * texture.m_width + srcX) * 4;
+    glTexSubImage2D(
+        GL_TEXTURE_2D,
+        0,
+        dstX,
+        dstY,
+        width,
+        height,
+        GL_RGBA,
+        GL_UNSIGNED_BYTE,
+        texture.m_source + offset
+    );
+}
+
+void TextureCache::addPage(int minSize) {
+    int size = k_pageSize;
+    while (size < minSize) {
+        size *= 2;
+    }
+
+    GLuint id;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D, id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(
+        GL_TEXTURE_2D,
+        0,
+        GL_RGBA,
+        size,
+        size,
+        0,
+        GL_RGBA,
+        GL_UNSIGNED_BYTE,
+        nullptr
+    );
+
+    m_pages.push_back({id, size, 0, 0, 0});
+}
+
+void TextureCache::deletePages(std::vector<Page> &pages) {
+    for (const Page &page : pages) {
+        glDeleteTextures(1, &page.id);
+    }
+    pages.clear();
+}
+
+} // namespace friimgui
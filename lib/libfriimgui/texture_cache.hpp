@@ -0,0 +1,192 @@
+#ifndef FRIIMGUI_TEXTURE_CACHE_HPP
+#define FRIIMGUI_TEXTURE_CACHE_HPP
+
+#include "resource_bundle.hpp"
+#include "thread_pool.hpp"
+
+#include <glad/glad.h>
+
+#include <imgui/imgui.h>
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace friimgui {
+
+// Image loaded from a file and placed into one of the atlas pages of the
+// TextureCache. The size is known right away, the pixels arrive once the
+// image is decoded or are taken from a mounted resource bundle. The
+// placement changes whenever the atlas is rebuilt, so it should be queried
+// when drawing.
+class Texture {
+public:
+    Texture(const Texture &) = delete;
+    Texture &operator= (const Texture &) = delete;
+
+    // Id of the atlas page holding the image, zero while it has none.
+    GLuint getId() const;
+    ImVec2 getUv0() const;
+    ImVec2 getUv1() const;
+    bool hasFailed() const;
+
+    int getWidth() const;
+    int getHeight() const;
+    size_t getByteSize() const;
+
+private:
+    friend class TextureCache;
+
+    Texture(int width, int height);
+
+    // Either the decoded pixels or the image inside a resource bundle
+    std::vector<unsigned char> m_pixels;
+    const unsigned char *m_source;
+    int m_width;
+    int m_height;
+    bool m_failed;
+
+    GLuint m_id;
+    ImVec2 m_uv0;
+    ImVec2 m_uv1;
+};
+
+// ==================================================
+
+struct TextureCacheStats {
+    size_t hits;
+    size_t misses;
+    size_t textureCount;
+    size_t pendingCount;
+    size_t pageCount;
+    size_t residentBytes;
+    size_t pixelBytes;
+};
+
+// Keeps every image file loaded at most once. Files are identified by their
+// canonical path, all images loaded from one file share a single texture.
+//
+// Images are decoded by a pool of worker threads, so acquire() makes no GL
+// calls and can be used from any thread. Decoded images are uploaded by
+// update() on the render thread, at most a budget of bytes per call.
+//
+// Textures are packed into shared atlas pages, so sprites of different
+// images can be drawn in one batch. A new image is placed into the free
+// space of the last page right away. The whole atlas is repacked once
+// images were released or a new one needed a page of its own, and no more
+// uploads are pending. Repacking moves the images to new pages within the
+// same upload budget, drawing from the old pages until it is done. The
+// decoded pixels stay in memory to allow this.
+//
+// Images found in a mounted resource bundle are neither read nor decoded,
+// they are uploaded straight from the mapped file.
+class TextureCache {
+public:
+    static constexpr int k_pageSize = 2048;
+    static constexpr size_t k_defaultUploadBudget = 16 << 20;
+
+    static TextureCache &getInstance();
+
+    TextureCache(const TextureCache &) = delete;
+    TextureCache &operator= (const TextureCache &) = delete;
+
+    std::shared_ptr<const Texture> acquire(
+        const std::filesystem::path &fileName
+    );
+
+    // Maps a bundle written by ResourceBundle::write(), its images replace
+    // the files of the same names acquired from now on. Returns false if the
+    // bundle does not exist.
+    bool mountBundle(const std::filesystem::path &fileName);
+
+    // Uploads decoded images and repacks the atlas if needed. Pages may be
+    // deleted, so this must be called outside of a frame.
+    void update();
+    void setUploadBudget(size_t bytes);
+
+    // Deletes all GL textures while their context still exists, handles
+    // held after that refer to no texture.
+    void releaseTextures();
+
+    TextureCacheStats getStats() const;
+
+private:
+    struct Entry {
+        Texture *texture;
+        std::weak_ptr<const Texture> handle;
+        std::uint64_t serial;
+    };
+
+    struct Decoded {
+        std::string key;
+        std::uint64_t serial;
+        std::vector<unsigned char> pixels;
+        const unsigned char *source;
+    };
+
+    struct Page {
+        GLuint id;
+        int size;
+        int shelfY;
+        int shelfHeight;
+        int cursorX;
+    };
+
+    TextureCache();
+
+    void decode(
+        const std::string &key,
+        const std::filesystem::path &fileName,
+        std::uint64_t serial
+    );
+    void release(const std::string &key, const Texture *texture);
+
+    size_t upload(Decoded &decoded);
+    void repack();
+    // False if the image did not fit the last page and got a new one
+    bool place(Texture &texture);
+    bool placeOnPage(Texture &texture, int pageIndex);
+    static void uploadRect(
+        const Texture &texture,
+        int srcX,
+        int srcY,
+        int width,
+        int height,
+        int dstX,
+        int dstY
+    );
+    void addPage(int minSize);
+    static void deletePages(std::vector<Page> &pages);
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;
+    std::vector<std::unique_ptr<ResourceBundle>> m_bundles;
+    std::unordered_map<std::string, ResourceBundle::Image> m_bundled;
+    std::deque<Decoded> m_decoded;
+    size_t m_pendingCount;
+    std::uint64_t m_nextSerial;
+    size_t m_uploadBudget;
+
+    std::vector<Page> m_pages;
+    // Pages of the previous packing, still holding images not yet moved by
+    // the repack in progress
+    std::vector<Page> m_retiredPages;
+    std::vector<Texture *> m_repacking;
+    bool m_dirty;
+
+    size_t m_hits;
+    size_t m_misses;
+    size_t m_pixelBytes;
+
+    // Declared last, so its workers are stopped before the rest goes away
+    std::unique_ptr<ThreadPool> m_decoder;
+};
+
+} // namespace friimgui
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef FRIIMGUI_THREAD_POOL_HPP
+#define FRIIMGUI_THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace friimgui {
+
+// Fixed set of worker threads running submitted tasks in submission order.
+// Tasks still queued when the pool is destroyed are dropped, running ones
+// are waited for.
+class ThreadPool {
+public:
+    // Zero means one thread per hardware thread.
+    explicit ThreadPool(unsigned threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator= (const ThreadPool &) = delete;
+
+    void submit(std::function<void()> task);
+
+private:
+    void work();
+
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    bool m_stopping;
+};
+
+} // namespace friimgui
+
+#endif
@@ -5,6 +5,74 @@
 
 namespace friimgui {
 
+AffineTransform AffineTransform::createIdentity() {
+    return {1, 0, 0, 1, 0, 0};
+}
+
+AffineTransform AffineTransform::createTranslation(ImVec2 vec) {
+    return {1, 0, 0, 1, vec.x, vec.y};
+}
+
+AffineTransform AffineTransform::createRotation(float angleRad, ImVec2 pivot) {
+    float s = sinf(angleRad);
+    float c = cosf(angleRad);
+
+    return {
+        c,
+        s,
+        -s,
+        c,
+        pivot.x - pivot.x * c + pivot.y * s,
+        pivot.y - pivot.x * s - pivot.y * c
+    };
+}
+
+AffineTransform AffineTransform::createScale(float s, ImVec2 pivot) {
+    return {s, 0, 0, s, pivot.x * (1 - s), pivot.y * (1 - s)};
+}
+
+AffineTransform AffineTransform::operator* (
+    const AffineTransform &other
+) const {
+    return {
+        a * other.a + c * other.b,
+        b * other.a + d * other.b,
+        a * other.c + c * other.d,
+        b * other.c + d * other.d,
+        a * other.tx + c * other.ty + tx,
+        b * other.tx + d * other.ty + ty
+    };
+}
+
+AffineTransform AffineTransform::translated(ImVec2 vec) const {
+    return {a, b, c, d, tx + vec.x, ty + vec.y};
+}
+
+// ==================================================
+
+const AffineTransform &Transformation::getMatrix() const {
+    const std::uint64_t stamps[3]
+        = {translation.getStamp(), rotation.getStamp(), scale.getStamp()};
+    if (stamps[0] == m_matrixStamps[0] && stamps[1] == m_matrixStamps[1]
+        && stamps[2] == m_matrixStamps[2]) {
+        return m_matrix;
+    }
+
+    m_matrix = AffineTransform::createTranslation(translation.getValueOrDef())
+             * AffineTransform::createRotation(
+                 rotation.getValueOrDef(),
+                 rotation.getPivotOrDef()
+             )
+             * AffineTransform::createScale(
+                 scale.getValueOrDef(),
+                 scale.getPivotOrDef()
+             );
+    std::copy(stamps, stamps + 3, m_matrixStamps);
+    return m_matrix;
+}
+
+// ==================================================
+
 Region Region::createAtPosTopLeft(
     int posLeft,
     int posTop,
@@ -230,6 +298,18 @@ void Region::scaleThis(const Transformation::ScaleComponent &scaleComponent) {
     scaleThis(scaleComponent.getValueOrDef(), scaleComponent.getPivotOrDef());
 }
 
+Region Region::transform(const AffineTransform &matrix) {
+    Region result(*this);
+    result.transformThis(matrix);
+    return result;
+}
+
+void Region::transformThis(const AffineTransform &matrix) {
+    for (int i = 0; i < 4; ++i) {
+        m_points[i] = matrix.apply(m_points[i]);
+    }
+}
+
 Region::Region(ImVec2 p0, ImVec2 p2) :
     Region(p0, {p2.x, p0.y}, p2, {p0.x, p2.y}) {
 }
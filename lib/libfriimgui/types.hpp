@@ -3,12 +3,51 @@
 
 #include <imgui/imgui.h>
 
+#include <atomic>
+#include <cstdint>
 #include <optional>
 
 namespace friimgui {
 
+// 2x3 matrix mapping [x, y] to [a x + c y + tx, b x + d y + ty].
+struct AffineTransform {
+    static AffineTransform createIdentity();
+    static AffineTransform createTranslation(ImVec2 vec);
+    static AffineTransform createRotation(float angleRad, ImVec2 pivot);
+    static AffineTransform createScale(float s, ImVec2 pivot);
+
+    // The result applies other first and this second.
+    AffineTransform operator* (const AffineTransform &other) const;
+
+    AffineTransform translated(ImVec2 vec) const;
+
+    ImVec2 apply(ImVec2 point) const {
+        return {
+            a * point.x + c * point.y + tx,
+            b * point.x + d * point.y + ty
+        };
+    }
+
+    float a;
+    float b;
+    float c;
+    float d;
+    float tx;
+    float ty;
+};
+
+// ==================================================
+
 struct Transformation {
 private:
+    // Every change of a component gets a new stamp, so equal stamps mean
+    // equal values even across copies of a component.
+    static std::uint64_t nextStamp() {
+        static std::atomic<std::uint64_t> s_counter = 0;
+        return s_counter.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+
     template<typename T>
     class TransformationComponent {
     public:
@@ -26,6 +65,10 @@ private:
             m_pivotOpt(pivot) {
         }
 
+        std::uint64_t getStamp() const {
+            return m_stamp;
+        }
+
         T getValueOrDef(const T &def = T()) const {
             return m_valueOpt.value_or(def);
         }
@@ -40,14 +83,17 @@ private:
 
         void setValue(T val) {
             m_valueOpt = val;
+            m_stamp = nextStamp();
         }
 
         void addValue(T val) {
             m_valueOpt = m_valueOpt.value_or(T()) + val;
+            m_stamp = nextStamp();
         }
 
         void resetValue() {
             m_valueOpt = std::nullopt;
+            m_stamp = nextStamp();
         }
 
         const ImVec2 getPivotOrDef(const ImVec2 &def = {0, 0}) const {
@@ -64,15 +110,18 @@ private:
 
         void setPivot(const ImVec2 &pivot) {
             m_pivotOpt = pivot;
+            m_stamp = nextStamp();
         }
 
         void resetPivot() {
             m_pivotOpt = std::nullopt;
+            m_stamp = nextStamp();
         }
 
     private:
         ValueOpt m_valueOpt = std::nullopt;
         PivotOpt m_pivotOpt = std::nullopt;
+        std::uint64_t m_stamp = nextStamp();
     };
 
 public:
@@ -93,9 +142,17 @@ public:
         scale.setPivot({0, 0});
     }
 
+    // Scales, then rotates, then translates, each about its pivot. The
+    // matrix is only rebuilt after one of the components has changed.
+    const AffineTransform &getMatrix() const;
+
     TranslationComponent translation;
     RotationComponent rotation;
     ScaleComponent scale;
+
+private:
+    mutable AffineTransform m_matrix = AffineTransform::createIdentity();
+    mutable std::uint64_t m_matrixStamps[3] = {0, 0, 0};
 };
 
 // ==================================================
@@ -163,7 +220,13 @@ public:
     void scaleThis(float s, const ImVec2 &pivot);
     void scaleThis(const Transformation::ScaleComponent &scaleComponent);
 
+    Region transform(const AffineTransform &matrix);
+    void transformThis(const AffineTransform &matrix);
+
 private:
+    friend class BatchTransform;
+    friend class RegionArray;
+
     Region(ImVec2 topLeft, ImVec2 bottomRight);
     Region(ImVec2 p0, ImVec2 p1, ImVec2 p2, ImVec2 p3);
 
@@ -176,6 +239,7 @@ inline void Transformation::TransformationComponent<ImVec2>::addValue(
 ) {
     ImVec2 t = m_valueOpt.value_or(ImVec2 {0, 0});
     m_valueOpt = {t.x + val.x, t.y + val.y};
+    m_stamp = nextStamp();
 }
 
 } // namespace friimgui
@@ -1,9 +1,30 @@
 #include "window.hpp"
+#include "draw_data_renderer.hpp"
+#include "frame_profiler.hpp"
+#include "rasterizer.hpp"
+#include "sprite_batch.hpp"
+#include "texture_cache.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <exception>
 #include <iostream>
+#include <thread>
 
 namespace friimgui {
 
+namespace {
+
+// Frames drawn after an event, ImGui needs more than one to apply some
+// changes such as the hovered item.
+constexpr int k_settleFrames = 3;
+
+// Headless frames advance by a fixed time step
+constexpr float k_headlessDeltaTime = 1.0f / 60;
+constexpr int k_headlessFontTexture = 1;
+
+} // namespace
+
 Window *Window::initializeWindow(size_t width, size_t height) {
     if (Window::k_instance == nullptr) {
         // 1. Initialize GLFW
@@ -20,6 +41,7 @@ Window *Window::initializeWindow(size_t width, size_t height) {
             return nullptr;
         }
         glfwMakeContextCurrent(window);
+        glfwSwapInterval(1);
 
         // 3. Load OpenGL functions with GLAD
         if (! gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
@@ -37,61 +59,281 @@ Window *Window::initializeWindow(size_t width, size_t height) {
         ImGui_ImplOpenGL3_Init();
 
         // 6. Create instance
-        Window::k_instance = new Window(window);
+        Window::k_instance = new Window(
+            window,
+            static_cast<int>(width),
+            static_cast<int>(height)
+        );
+    }
+    return Window::k_instance;
+}
+
+Window *Window::initializeHeadless(size_t width, size_t height) {
+    if (Window::k_instance == nullptr) {
+        Window *window = new Window(
+            nullptr,
+            static_cast<int>(width),
+            static_cast<int>(height)
+        );
+
+        IMGUI_CHECKVERSION();
+        ImGui::CreateContext();
+        ImGui::StyleColorsDark();
+
+        // Without a platform and renderer backend the display and the font
+        // atlas are set up here
+        ImGuiIO &io = ImGui::GetIO();
+        io.DisplaySize = ImVec2(window->m_width, window->m_height);
+        io.DeltaTime = k_headlessDeltaTime;
+        io.IniFilename = nullptr;
+        io.Fonts->GetTexDataAsRGBA32(
+            &window->m_fontPixels,
+            &window->m_fontWidth,
+            &window->m_fontHeight
+        );
+        io.Fonts->SetTexID((ImTextureID)(intptr_t)k_headlessFontTexture);
+
+        Window::k_instance = window;
     }
     return Window::k_instance;
 }
 
 void Window::releaseWindow() {
-    if (Window::k_instance != nullptr) {
+    if (Window::k_instance != nullptr && Window::k_instance->isHeadless()) {
+        ImGui::DestroyContext();
+        delete Window::k_instance;
+        Window::k_instance = nullptr;
+    } else if (Window::k_instance != nullptr) {
         // 1. Cleanup Dear ImGui
         ImGui_ImplOpenGL3_Shutdown();
         ImGui_ImplGlfw_Shutdown();
         ImGui::DestroyContext();
 
-        // 2. Cleanup GLFW
+        // 2. Delete GL objects still held while the context exists
+        SpriteBatch::getInstance().release();
+        TextureCache::getInstance().releaseTextures();
+
+        // 3. Cleanup GLFW
         glfwDestroyWindow(Window::k_instance->m_GLFWwindow);
         glfwTerminate();
 
-        // 3. Release instance
+        // 4. Release instance
         delete Window::k_instance;
         Window::k_instance = nullptr;
     }
 }
 
+void Window::requestRedraw() {
+    k_redrawRequested = true;
+    if (Window::k_instance != nullptr && ! Window::k_instance->isHeadless()) {
+        glfwPostEmptyEvent();
+    }
+}
+
 void friimgui::Window::setGUI(GUIBuilder *GUIBuilder) {
     m_GUIBuilder = GUIBuilder;
 }
 
+void Window::setVsync(bool enabled) {
+    if (! isHeadless()) {
+        glfwSwapInterval(enabled ? 1 : 0);
+    }
+}
+
+void Window::setFrameRateLimit(double framesPerSecond) {
+    m_frameRateLimit = framesPerSecond;
+}
+
+void Window::setIdleTimeout(double seconds) {
+    m_idleTimeout = seconds;
+}
+
+void Window::setFrameCount(int frameCount) {
+    m_frameCount = frameCount;
+}
+
+void Window::setFramebufferDump(const std::filesystem::path &fileName) {
+    m_dumpFileName = fileName;
+}
+
 void Window::run() {
-    while (! glfwWindowShouldClose(m_GLFWwindow)) {
-        glfwPollEvents();
+    using Phase = FrameProfiler::ScopedPhase;
+    FrameProfiler &profiler = FrameProfiler::getInstance();
+
+    int remainingFrames = m_frameCount == 0 && isHeadless()
+                            ? k_defaultHeadlessFrameCount
+                            : m_frameCount;
+    m_pendingFrames = k_settleFrames;
+    while (isHeadless() || ! glfwWindowShouldClose(m_GLFWwindow)) {
+        const bool lastFrame = remainingFrames == 1;
+
+        profiler.beginFrame();
+        if (! isHeadless()) {
+            Phase phase(profiler, FramePhase::Wait);
+            waitForFrame();
+        }
+
+        {
+            // Atlas pages may be replaced only between frames
+            Phase phase(profiler, FramePhase::Update);
+            if (! isHeadless()) {
+                TextureCache::getInstance().update();
+            }
+            SpriteBatch::getInstance().beginFrame();
+        }
+
+        // 1. Start new ImGui frame and build GUI
+        {
+            Phase phase(profiler, FramePhase::Build);
+            if (! isHeadless()) {
+                ImGui_ImplOpenGL3_NewFrame();
+                ImGui_ImplGlfw_NewFrame();
+            }
+            ImGui::NewFrame();
+
+            if (m_GUIBuilder != nullptr) {
+                m_GUIBuilder->build();
+            }
+            profiler.drawOverlay();
+        }
+
+        // 2. Render GUI
+        {
+            Phase phase(profiler, FramePhase::Render);
+            ImGui::Render();
+        }
+        if (! isHeadless()) {
+            {
+                Phase phase(profiler, FramePhase::RenderDrawData);
+                int display_w, display_h;
+                glfwGetFramebufferSize(m_GLFWwindow, &display_w, &display_h);
+                glViewport(0, 0, display_w, display_h);
+                glClear(GL_COLOR_BUFFER_BIT);
+                ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            }
+            if (lastFrame && ! m_dumpFileName.empty()) {
+                dumpFramebuffer();
+            }
+            {
+                Phase phase(profiler, FramePhase::SwapBuffers);
+                glfwSwapBuffers(m_GLFWwindow);
+            }
+        } else if (lastFrame && ! m_dumpFileName.empty()) {
+            Phase phase(profiler, FramePhase::RenderDrawData);
+            dumpFramebuffer();
+        }
+        profiler.endFrame(ImGui::GetDrawData());
+
+        if (remainingFrames > 0 && --remainingFrames == 0) {
+            break;
+        }
+    }
+}
 
-        // 1. Start new ImGui frame
-        ImGui_ImplOpenGL3_NewFrame();
-        ImGui_ImplGlfw_NewFrame();
-        ImGui::NewFrame();
+void Window::waitForFrame() {
+    const bool redrawRequested = k_redrawRequested.exchange(false);
+    const bool animating
+        = (m_GUIBuilder != nullptr && m_GUIBuilder->isAnimating())
+       || TextureCache::getInstance().getStats().pendingCount > 0;
+    const bool busy = m_pendingFrames > 0 || redrawRequested || animating;
+    if (m_pendingFrames > 0) {
+        --m_pendingFrames;
+    }
 
-        // 2. Build GUI
-        if (m_GUIBuilder != nullptr) {
-            m_GUIBuilder->build();
+    if (! busy) {
+        // Waking up before the timeout means an event or a redraw request
+        const double start = glfwGetTime();
+        glfwWaitEventsTimeout(m_idleTimeout);
+        if (glfwGetTime() - start < m_idleTimeout * 0.99) {
+            m_pendingFrames = k_settleFrames;
+        }
+    } else {
+        if (m_frameRateLimit > 0) {
+            const double wait = m_nextFrameTime - glfwGetTime();
+            if (wait > 0) {
+                std::this_thread::sleep_for(
+                    std::chrono::duration<double>(wait)
+                );
+            }
         }
+        glfwPollEvents();
+    }
+
+    // Keeps the cadence unless the frame is late
+    if (m_frameRateLimit > 0) {
+        m_nextFrameTime = std::max(m_nextFrameTime, glfwGetTime())
+                        + 1.0 / m_frameRateLimit;
+    }
+}
+
+bool Window::hasGLContext() {
+    return Window::k_instance != nullptr && ! Window::k_instance->isHeadless();
+}
+
+bool Window::isHeadless() const {
+    return m_GLFWwindow == nullptr;
+}
+
+void Window::dumpFramebuffer() const {
+    int width = m_width;
+    int height = m_height;
+    if (! isHeadless()) {
+        glfwGetFramebufferSize(m_GLFWwindow, &width, &height);
+    }
+
+    Bitmap bitmap(width, height);
+    if (isHeadless()) {
+        DrawDataRenderer renderer;
+        renderer.setTexture(
+            (ImTextureID)(intptr_t)k_headlessFontTexture,
+            m_fontPixels,
+            m_fontWidth,
+            m_fontHeight
+        );
+        renderer.render(*ImGui::GetDrawData(), bitmap);
+    } else {
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(
+            0,
+            0,
+            width,
+            height,
+            GL_RGBA,
+            GL_UNSIGNED_BYTE,
+            bitmap.getPixels()
+        );
 
-        // 3. Render GUI
-        ImGui::Render();
-        int display_w, display_h;
-        glfwGetFramebufferSize(m_GLFWwindow, &display_w, &display_h);
-        glViewport(0, 0, display_w, display_h);
-        glClear(GL_COLOR_BUFFER_BIT);
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        // GL rows go from the bottom up
+        ImU32 *pixels = bitmap.getPixels();
+        for (int y = 0; y < height / 2; ++y) {
+            ImU32 *top = pixels + static_cast<size_t>(y) * width;
+            ImU32 *bottom
+                = pixels + static_cast<size_t>(height - 1 - y) * width;
+            std::swap_ranges(top, top + width, bottom);
+        }
+    }
 
-        glfwSwapBuffers(m_GLFWwindow);
+    try {
+        bitmap.savePng(m_dumpFileName);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
     }
 }
 
-Window::Window(GLFWwindow *glfwWindow) :
+Window::Window(GLFWwindow *glfwWindow, int width, int height) :
     m_GLFWwindow(glfwWindow),
-    m_GUIBuilder(nullptr) {
+    m_GUIBuilder(nullptr),
+    m_width(width),
+    m_height(height),
+    m_frameCount(0),
+    m_dumpFileName(),
+    m_fontPixels(nullptr),
+    m_fontWidth(0),
+    m_fontHeight(0),
+    m_frameRateLimit(0),
+    m_idleTimeout(k_defaultIdleTimeout),
+    m_nextFrameTime(0),
+    m_pendingFrames(0) {
     // io = ImGui::GetIO();
     // io.ConfigFlags |= ImGuiConfigFlags_DockingEnable; // optional
     // io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable; // optional
@@ -103,5 +345,6 @@ Window::~Window() {
 }
 
 Window *Window::k_instance = nullptr;
+std::atomic<bool> Window::k_redrawRequested = false;
 
 } // namespace friimgui
\ No newline at end of file
@@ -11,25 +11,79 @@
 #include <imgui/backends/imgui_impl_opengl3.h>
 #include <imgui/imgui.h>
 
+#include <atomic>
+#include <filesystem>
+
 namespace friimgui {
 
+// Renders only while something changes. Without input, redraw requests,
+// pending texture uploads or an animating GUI the window sleeps in
+// glfwWaitEventsTimeout() and draws a single frame per idle timeout. After
+// an event a few more frames are drawn so ImGui can settle hover and focus
+// changes.
+//
+// A headless window has no GLFW window, GL context or input. ImGui runs
+// without any renderer, its frames are only drawn on the CPU when the
+// framebuffer is dumped. Textures are never uploaded, images are drawn as
+// placeholders.
 class Window {
 public:
+    static constexpr double k_defaultIdleTimeout = 1.0;
+    static constexpr int k_defaultHeadlessFrameCount = 60;
+
     static Window *initializeWindow(size_t width, size_t height);
+    static Window *initializeHeadless(size_t width, size_t height);
     static void releaseWindow();
 
+    // Wakes the window up to draw new frames, callable from any thread.
+    static void requestRedraw();
+
+    // False without a window and for a headless one, GL may be called only
+    // while true.
+    static bool hasGLContext();
+
     void setGUI(GUIBuilder *GUIBuilder);
 
+    void setVsync(bool enabled);
+    // Zero removes the limit.
+    void setFrameRateLimit(double framesPerSecond);
+    void setIdleTimeout(double seconds);
+
+    // Stops run() after the given number of frames, zero runs until the
+    // window is closed. Headless windows cannot be closed, for them zero
+    // means k_defaultHeadlessFrameCount frames.
+    void setFrameCount(int frameCount);
+    // Saves the last frame of run() as a PNG file.
+    void setFramebufferDump(const std::filesystem::path &fileName);
+
     void run();
 
 private:
-    Window(GLFWwindow *glfwWindow);
+    Window(GLFWwindow *glfwWindow, int width, int height);
     ~Window();
 
+    bool isHeadless() const;
+    void waitForFrame();
+    void dumpFramebuffer() const;
+
     GLFWwindow *m_GLFWwindow;
     GUIBuilder *m_GUIBuilder;
+    int m_width;
+    int m_height;
+
+    int m_frameCount;
+    std::filesystem::path m_dumpFileName;
+    unsigned char *m_fontPixels;
+    int m_fontWidth;
+    int m_fontHeight;
+
+    double m_frameRateLimit;
+    double m_idleTimeout;
+    double m_nextFrameTime;
+    int m_pendingFrames;
 
     static Window *k_instance;
+    static std::atomic<bool> k_redrawRequested;
 };
 
 } // namespace friimgui
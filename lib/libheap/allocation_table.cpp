@@ -0,0 +1,202 @@
+#include "allocation_table.hpp"
+
+#include <cstdlib>
+
+namespace fri {
+
+namespace details {
+
+namespace {
+
+constexpr std::size_t k_initialSiteCapacity = 256;
+constexpr std::size_t k_initialSlotCapacity = 1024;
+
+std::size_t hashValue(std::uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDull;
+    return static_cast<std::size_t>(value ^ (value >> 33));
+}
+
+std::size_t hashSite(const char *file, int line) {
+    return hashValue(
+        reinterpret_cast<std::uintptr_t>(file)
+        ^ static_cast<std::uint64_t>(static_cast<unsigned>(line)) << 48
+    );
+}
+
+} // namespace
+
+CallSiteTable::CallSiteTable() :
+    m_sites(nullptr),
+    m_count(0),
+    m_index(nullptr),
+    m_capacity(0) {
+}
+
+CallSiteTable::~CallSiteTable() {
+    std::free(m_sites);
+    std::free(m_index);
+}
+
+std::uint32_t CallSiteTable::intern(const char *file, int line) {
+    // The table is at most half full, so there always is an empty slot
+    if (m_count >= m_capacity / 2) {
+        grow();
+    }
+
+    const std::size_t mask = m_capacity - 1;
+    std::size_t i = hashSite(file, line) & mask;
+    while (m_index[i] != 0) {
+        const CallSite &site = m_sites[m_index[i] - 1];
+        if (site.file == file && site.line == line) {
+            return m_index[i] - 1;
+        }
+        i = (i + 1) & mask;
+    }
+
+    m_sites[m_count] = {file, line, {0, 0, 0, 0}};
+    m_index[i] = static_cast<std::uint32_t>(++m_count);
+    return m_index[i] - 1;
+}
+
+CallSite &CallSiteTable::get(std::uint32_t id) {
+    return m_sites[id];
+}
+
+const CallSite &CallSiteTable::get(std::uint32_t id) const {
+    return m_sites[id];
+}
+
+std::size_t CallSiteTable::size() const {
+    return m_count;
+}
+
+void CallSiteTable::grow() {
+    const std::size_t capacity
+        = m_capacity == 0 ? k_initialSiteCapacity : m_capacity * 2;
+    CallSite *sites = static_cast<CallSite *>(
+        std::realloc(m_sites, capacity / 2 * sizeof(CallSite))
+    );
+    std::uint32_t *index = static_cast<std::uint32_t *>(
+        std::calloc(capacity, sizeof(std::uint32_t))
+    );
+    if (! sites || ! index) {
+        std::abort();
+    }
+
+    const std::size_t mask = capacity - 1;
+    for (std::size_t id = 0; id < m_count; ++id) {
+        std::size_t i = hashSite(sites[id].file, sites[id].line) & mask;
+        while (index[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        index[i] = static_cast<std::uint32_t>(id + 1);
+    }
+
+    std::free(m_index);
+    m_sites = sites;
+    m_index = index;
+    m_capacity = capacity;
+}
+
+// ==================================================
+
+AllocationTable::AllocationTable() :
+    m_slots(nullptr),
+    m_count(0),
+    m_deletedCount(0),
+    m_capacity(0) {
+}
+
+AllocationTable::~AllocationTable() {
+    std::free(m_slots);
+}
+
+void AllocationTable::insert(const void *p, std::uint32_t site) {
+    if (p == nullptr) {
+        return;
+    }
+    if ((m_count + m_deletedCount + 1) * 2 > m_capacity) {
+        rebuild();
+    }
+
+    // The key may follow a deleted slot, which is only reused once the key
+    // is known to be missing
+    const std::uintptr_t key = reinterpret_cast<std::uintptr_t>(p);
+    const std::size_t mask = m_capacity - 1;
+    std::size_t i = hashValue(key) & mask;
+    std::size_t free = m_capacity;
+    for (; m_slots[i].key != 0; i = (i + 1) & mask) {
+        if (m_slots[i].key == key) {
+            m_slots[i].site = site;
+            return;
+        }
+        if (m_slots[i].key == k_deleted && free == m_capacity) {
+            free = i;
+        }
+    }
+    if (free != m_capacity) {
+        i = free;
+        --m_deletedCount;
+    }
+    m_slots[i] = {key, site};
+    ++m_count;
+}
+
+bool AllocationTable::erase(const void *p, std::uint32_t *site) {
+    const std::uintptr_t key = reinterpret_cast<std::uintptr_t>(p);
+    if (key <= k_deleted || m_capacity == 0) {
+        return false;
+    }
+
+    const std::size_t mask = m_capacity - 1;
+    for (std::size_t i = hashValue(key) & mask; m_slots[i].key != 0;
+         i = (i + 1) & mask) {
+        if (m_slots[i].key == key) {
+            *site = m_slots[i].site;
+            m_slots[i].key = k_deleted;
+            --m_count;
+            ++m_deletedCount;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::size_t AllocationTable::size() const {
+    return m_count;
+}
+
+void AllocationTable::rebuild() {
+    // Grows only if live entries alone would fill a quarter of the table,
+    // otherwise dropping the deleted slots makes enough room
+    std::size_t capacity = m_capacity == 0 ? k_initialSlotCapacity : m_capacity;
+    while ((m_count + 1) * 4 > capacity) {
+        capacity *= 2;
+    }
+    Slot *slots = static_cast<Slot *>(std::calloc(capacity, sizeof(Slot)));
+    if (! slots) {
+        std::abort();
+    }
+
+    const std::size_t mask = capacity - 1;
+    for (std::size_t j = 0; j < m_capacity; ++j) {
+        if (m_slots[j].key <= k_deleted) {
+            continue;
+        }
+        std::size_t i = hashValue(m_slots[j].key) & mask;
+        while (slots[i].key != 0) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = m_slots[j];
+    }
+
+    std::free(m_slots);
+    m_slots = slots;
+    m_deletedCount = 0;
+    m_capacity = capacity;
+}
+
+} // namespace details
+
+} // namespace fri
@@ -0,0 +1,105 @@
+#ifndef HEAP_ALLOCATION_TABLE_HPP
+#define HEAP_ALLOCATION_TABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// The tables below back the HeapMonitor, which runs inside operator new.
+// They allocate their storage with malloc, so they never call back into it.
+
+namespace fri {
+
+namespace details {
+
+struct SiteStats {
+    std::uint64_t count;
+    std::uint64_t bytes;
+    std::uint64_t liveBytes;
+    std::uint64_t peakLiveBytes;
+};
+
+struct CallSite {
+    const char *file;
+    int line;
+    SiteStats stats;
+};
+
+// Gives every distinct file and line a small id, so that allocations only
+// have to store the id. Each site also collects the statistics of the blocks
+// allocated there. Files are compared by address, which is enough for
+// __FILE__ literals.
+class CallSiteTable {
+public:
+    CallSiteTable();
+    CallSiteTable(const CallSiteTable &) = delete;
+    void operator= (const CallSiteTable &) = delete;
+    ~CallSiteTable();
+
+public:
+    std::uint32_t intern(const char *file, int line);
+    CallSite &get(std::uint32_t id);
+    const CallSite &get(std::uint32_t id) const;
+    std::size_t size() const;
+
+private:
+    void grow();
+
+private:
+    CallSite *m_sites;
+    std::size_t m_count;
+    // Open addressing index of ids into m_sites, offset by one so that zero
+    // marks an empty slot. Its capacity is a power of two.
+    std::uint32_t *m_index;
+    std::size_t m_capacity;
+};
+
+// ==================================================
+
+// Maps the address of every live block to the id of its call site. Linear
+// probing over a power of two capacity, erased slots are marked as deleted
+// and reused by later insertions. The table is rebuilt once live and deleted
+// slots together fill half of it.
+class AllocationTable {
+public:
+    AllocationTable();
+    AllocationTable(const AllocationTable &) = delete;
+    void operator= (const AllocationTable &) = delete;
+    ~AllocationTable();
+
+public:
+    void insert(const void *p, std::uint32_t site);
+    // Stores the site of the erased block, if there was one
+    bool erase(const void *p, std::uint32_t *site);
+    std::size_t size() const;
+
+    template<class Function>
+    void forEach(Function function) const {
+        for (std::size_t i = 0; i < m_capacity; ++i) {
+            if (m_slots[i].key > k_deleted) {
+                function(m_slots[i].site);
+            }
+        }
+    }
+
+private:
+    static constexpr std::uintptr_t k_deleted = 1;
+
+    struct Slot {
+        std::uintptr_t key;
+        std::uint32_t site;
+    };
+
+    void rebuild();
+
+private:
+    Slot *m_slots;
+    std::size_t m_count;
+    std::size_t m_deletedCount;
+    std::size_t m_capacity;
+};
+
+} // namespace details
+
+} // namespace fri
+
+#endif // HEAP_ALLOCATION_TABLE_HPP
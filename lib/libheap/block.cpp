@@ -0,0 +1,62 @@
+#include "block.hpp"
+
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace fri {
+
+namespace details {
+
+BlockHeader *allocateBlock(std::size_t size, std::size_t alignment) {
+    BlockHeader *header = nullptr;
+    if (alignment <= alignof(std::max_align_t)) {
+        header = static_cast<BlockHeader *>(
+            std::malloc(sizeof(BlockHeader) + size)
+        );
+        if (header == nullptr) {
+            return nullptr;
+        }
+        header->aligned = 0;
+    } else {
+        // The header and the original address fit in front of the user
+        // part, because the alignment is at least twice the header size
+        const std::size_t total
+            = (alignment + size + alignment - 1) / alignment * alignment;
+#ifdef _WIN32
+        void *raw = _aligned_malloc(total, alignment);
+#else
+        void *raw = std::aligned_alloc(alignment, total);
+#endif
+        char *memory = static_cast<char *>(raw);
+        if (memory == nullptr) {
+            return nullptr;
+        }
+        header = reinterpret_cast<BlockHeader *>(memory + alignment) - 1;
+        reinterpret_cast<void **>(header)[-1] = memory;
+        header->aligned = 1;
+    }
+    header->owner = nullptr;
+    header->size = size;
+    header->counted = 0;
+    header->stack = 0;
+    return header;
+}
+
+void freeBlock(BlockHeader *header) {
+    if (! header->aligned) {
+        std::free(header);
+        return;
+    }
+#ifdef _WIN32
+    _aligned_free(reinterpret_cast<void **>(header)[-1]);
+#else
+    std::free(reinterpret_cast<void **>(header)[-1]);
+#endif
+}
+
+} // namespace details
+
+} // namespace fri
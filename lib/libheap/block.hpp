@@ -0,0 +1,51 @@
+#ifndef HEAP_BLOCK_HPP
+#define HEAP_BLOCK_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace fri {
+
+namespace details {
+
+class HeapShard;
+
+// Placed in front of every block handed out by operator new, 16 bytes in
+// every build. Untracked blocks have no owner. While a block waits in the remote free stack of its
+// owner, the owner field links it to the next one.
+struct BlockHeader {
+    union {
+        HeapShard *owner;
+        BlockHeader *next;
+    };
+    std::uint64_t size : 46;
+    // Set if the memory starts before the header, its address is stored
+    // right in front of the header
+    std::uint64_t aligned : 1;
+    // Set if the block was allocated while the HeapStats were counting
+    std::uint64_t counted : 1;
+    // Id of the sampled stack trace, zero if the block was not sampled
+    std::uint64_t stack : 16;
+};
+
+static_assert(sizeof(BlockHeader) == 16);
+static_assert(sizeof(BlockHeader) % alignof(std::max_align_t) == 0);
+
+// Returns null if there is no memory. The user part of the block is aligned
+// to the alignment, which must be a power of two.
+BlockHeader *allocateBlock(std::size_t size, std::size_t alignment);
+void freeBlock(BlockHeader *header);
+
+inline void *getUserPointer(BlockHeader *header) {
+    return header + 1;
+}
+
+inline BlockHeader *getHeader(void *p) {
+    return static_cast<BlockHeader *>(p) - 1;
+}
+
+} // namespace details
+
+} // namespace fri
+
+#endif // HEAP_BLOCK_HPP
@@ -1,58 +1,382 @@
 #include "heap_monitor.hpp"
 
+#ifndef NDEBUG
+
 #undef new
 
+#include "heap_shard.hpp"
+
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
 
 namespace fri {
 
 namespace details {
 
-HeapMonitor::~HeapMonitor() {
-    if (m_allocations.empty()) {
+namespace {
+
+thread_local HeapShard *t_shard = nullptr;
+thread_local bool t_exited = false;
+
+// Set while the thread is merging the shards, what it allocates meanwhile
+// is not tracked, so it never waits for the lock of its own shard
+thread_local bool t_reporting = false;
+
+thread_local unsigned t_eventCount = 0;
+
+// Sampled stacks with live blocks printed with the leaks at exit
+constexpr std::size_t k_reportedStackCount = 10;
+
+void writeStack(std::ostream &out, const HeapStackProfile &stack) {
+    out << "  " << stack.count << " sampled, " << stack.bytes << " bytes, "
+        << stack.liveCount << " live, " << stack.liveBytes
+        << " live bytes\n";
+    for (const std::string &frame : stack.frames) {
+        out << "      " << frame << "\n";
+    }
+}
+
+class ReportingScope {
+public:
+    ReportingScope() :
+        m_previous(t_reporting) {
+        t_reporting = true;
+    }
+
+    ~ReportingScope() {
+        t_reporting = m_previous;
+    }
+
+private:
+    bool m_previous;
+};
+
+} // namespace
+
+// Abandons the shard of a thread once it exits
+struct HeapMonitor::ThreadShard {
+    ~ThreadShard() {
+        t_exited = true;
+        if (t_shard != nullptr) {
+            HeapMonitor::getInstance().abandonShard(t_shard);
+            t_shard = nullptr;
+        }
+    }
+};
+
+HeapMonitor &HeapMonitor::getInstance() {
+    alignas(HeapMonitor) static unsigned char storage[sizeof(HeapMonitor)];
+    static HeapMonitor *instance = ::new (storage) HeapMonitor();
+    return *instance;
+}
+
+void HeapMonitor::track(BlockHeader *header, const char *file, int line) {
+    if (t_reporting) {
         return;
     }
+    header->owner = getShard();
+    if (header->owner != nullptr) {
+        header->owner->insert(header, file, line);
+        countEvent();
+    }
+}
+
+bool HeapMonitor::untrack(BlockHeader *header) {
+    if (header->owner != t_shard) {
+        header->owner->pushRemote(header);
+        return false;
+    }
+    header->owner->erase(header);
+    countEvent();
+    return true;
+}
+
+std::size_t HeapMonitor::countLiveBlocks() {
+    std::size_t count = 0;
+    for (HeapShard *shard = m_shards.load(std::memory_order_acquire); shard;
+         shard = shard->m_nextShard) {
+        count += shard->countBlocks();
+    }
+    return count;
+}
+
+std::size_t HeapMonitor::getLiveBytes() {
+    std::size_t bytes = 0;
+    for (HeapShard *shard = m_shards.load(std::memory_order_acquire); shard;
+         shard = shard->m_nextShard) {
+        bytes += shard->getLiveBytes();
+    }
+    return bytes;
+}
+
+void HeapMonitor::reportLeaks() {
+    ReportingScope scope;
+    std::map<std::pair<std::string, int>, int> leaks;
+    for (HeapShard *shard = m_shards.load(std::memory_order_acquire); shard;
+         shard = shard->m_nextShard) {
+        shard->forEachBlock([&leaks](const char *file, int line) {
+            ++leaks[{file, line}];
+        });
+    }
 
-    std::map<std::string, int> leaks;
-    for (const auto &[p, loc] : m_allocations) {
-        ++leaks[loc];
+    if (! leaks.empty()) {
+        std::cerr << "\n\n~~~\nDetected memory leaks!\n";
+        for (const auto &[loc, count] : leaks) {
+            std::cerr << "  " << loc.first << ":" << loc.second << "\t"
+                      << count << "x" << "\n";
+        }
+        std::cerr << "\n";
     }
 
-    std::cerr << "\n\n~~~\nDetected memory leaks!\n";
-    for (const auto &[loc, count] : leaks) {
-        std::cerr << "  " << loc << "\t" << count << "x" << "\n";
+    // Sampled blocks still alive include those of the standard library
+    // and of code without the new macro
+    std::vector<HeapStackProfile> stacks
+        = HeapSampler::getInstance().getStackProfiles(HeapProfileOrder::Bytes);
+    std::erase_if(stacks, [](const HeapStackProfile &stack) {
+        return stack.liveCount == 0;
+    });
+    std::sort(
+        stacks.begin(),
+        stacks.end(),
+        [](const HeapStackProfile &a, const HeapStackProfile &b) {
+            return a.liveBytes > b.liveBytes;
+        }
+    );
+    if (stacks.size() > k_reportedStackCount) {
+        stacks.resize(k_reportedStackCount);
+    }
+    if (! stacks.empty()) {
+        std::cerr << "Sampled blocks still allocated at exit:\n";
+        for (const HeapStackProfile &stack : stacks) {
+            writeStack(std::cerr, stack);
+        }
+        std::cerr << "\n";
     }
-    std::cerr << "\n";
 }
 
-void HeapMonitor::logAllocation(void *p, std::string file, int line) {
-    const std::intptr_t ip = reinterpret_cast<std::intptr_t>(p);
-    std::string loc = file + ":" + std::to_string(line);
-    (void)m_allocations.try_emplace(ip, std::move(loc));
+void HeapMonitor::setProfiling(bool enabled) {
+    m_profiling.store(enabled, std::memory_order_relaxed);
 }
 
-void HeapMonitor::logDeletion(void *p) {
-    (void)m_allocations.erase(reinterpret_cast<std::intptr_t>(p));
+bool HeapMonitor::isProfiling() const {
+    return m_profiling.load(std::memory_order_relaxed);
 }
 
-} // namespace details
+std::vector<HeapSiteProfile> HeapMonitor::getSiteProfiles(
+    HeapProfileOrder order
+) {
+    ReportingScope scope;
 
-} // namespace fri
+    // The same file may be interned by several threads
+    std::map<std::pair<std::string, int>, HeapSiteProfile> merged;
+    for (HeapShard *shard = m_shards.load(std::memory_order_acquire); shard;
+         shard = shard->m_nextShard) {
+        shard->forEachSite([&merged](const CallSite &site) {
+            HeapSiteProfile &profile = merged[{site.file, site.line}];
+            profile.count += site.stats.count;
+            profile.bytes += site.stats.bytes;
+            profile.liveBytes += site.stats.liveBytes;
+            profile.peakLiveBytes += site.stats.peakLiveBytes;
+        });
+    }
 
-void *operator new (std::size_t sz, const char *file, int line) {
-    void *p = std::malloc(sz);
-    ::fri::details::HeapMonitor::getInstance().logAllocation(p, file, line);
-    return p;
+    std::vector<HeapSiteProfile> profiles;
+    profiles.reserve(merged.size());
+    for (auto &[loc, profile] : merged) {
+        profile.file = loc.first;
+        profile.line = loc.second;
+        profiles.push_back(std::move(profile));
+    }
+    std::sort(
+        profiles.begin(),
+        profiles.end(),
+        [order](const HeapSiteProfile &a, const HeapSiteProfile &b) {
+            return order == HeapProfileOrder::Count ? a.count > b.count
+                                                    : a.bytes > b.bytes;
+        }
+    );
+    return profiles;
 }
 
-void operator delete (void *p) noexcept {
-    ::fri::details::HeapMonitor::getInstance().logDeletion(p);
-    std::free(p);
+std::vector<HeapTimelineSample> HeapMonitor::getTimeline() {
+    // Allocating while holding the timeline would only skip a sample
+    std::vector<HeapTimelineSample> timeline;
+    timeline.reserve(k_timelineCapacity);
+    lockTimeline();
+    timeline.assign(m_timeline, m_timeline + m_timelineCount);
+    m_timelineLocked.clear(std::memory_order_release);
+    return timeline;
 }
 
-void operator delete (void *p, std::size_t n) noexcept {
-    (void)n;
-    ::fri::details::HeapMonitor::getInstance().logDeletion(p);
-    std::free(p);
+bool HeapMonitor::writeProfile(const char *fileName, HeapProfileOrder order) {
+    ReportingScope scope;
+    const std::vector<HeapSiteProfile> profiles = getSiteProfiles(order);
+    const std::vector<HeapTimelineSample> timeline = getTimeline();
+
+    std::ofstream file(fileName);
+    if (! file) {
+        return false;
+    }
+
+    const std::chrono::duration<double> elapsed
+        = std::chrono::steady_clock::now() - m_start;
+    std::size_t peakBytes = 0;
+    for (const HeapTimelineSample &sample : timeline) {
+        peakBytes = std::max(peakBytes, sample.liveBytes);
+    }
+    file << "Heap profile after " << elapsed.count() << " s\n"
+         << "Live blocks: " << countLiveBlocks() << "\n"
+         << "Live bytes: " << getLiveBytes() << "\n"
+         << "Peak sampled live bytes: " << peakBytes << "\n\n";
+
+    file << "Call sites by "
+         << (order == HeapProfileOrder::Count ? "count" : "bytes") << "\n"
+         << std::setw(12) << "count" << std::setw(16) << "bytes"
+         << std::setw(16) << "live bytes" << std::setw(16) << "peak bytes"
+         << "  site\n";
+    for (const HeapSiteProfile &profile : profiles) {
+        file << std::setw(12) << profile.count << std::setw(16)
+             << profile.bytes << std::setw(16) << profile.liveBytes
+             << std::setw(16) << profile.peakLiveBytes << "  "
+             << profile.file << ":" << profile.line << "\n";
+    }
+
+    const std::vector<HeapStackProfile> stacks
+        = HeapSampler::getInstance().getStackProfiles(order);
+    if (! stacks.empty()) {
+        file << "\nSampled stacks, one in about "
+             << HeapSampler::getInstance().getSampleRate()
+             << " allocations\n";
+        for (const HeapStackProfile &stack : stacks) {
+            writeStack(file, stack);
+        }
+    }
+
+    file << "\nTimeline\nseconds,live bytes\n";
+    for (const HeapTimelineSample &sample : timeline) {
+        file << sample.seconds << "," << sample.liveBytes << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+HeapMonitor::HeapMonitor() :
+    m_mutex(),
+    m_shards(nullptr),
+    m_profiling(false),
+    m_profileFile(std::getenv("FRI_HEAP_PROFILE")),
+    m_profileOrder(HeapProfileOrder::Bytes),
+    m_timelineLocked(),
+    m_start(std::chrono::steady_clock::now()),
+    m_sampleInterval(k_initialSampleInterval),
+    m_nextSample(0),
+    m_timeline(),
+    m_timelineCount(0) {
+    if (m_profileFile != nullptr && *m_profileFile != '\0') {
+        m_profiling.store(true, std::memory_order_relaxed);
+        const char *order = std::getenv("FRI_HEAP_PROFILE_ORDER");
+        if (order != nullptr && std::strcmp(order, "count") == 0) {
+            m_profileOrder = HeapProfileOrder::Count;
+        }
+    } else {
+        m_profileFile = nullptr;
+    }
+
+    std::atexit([] {
+        HeapMonitor &monitor = getInstance();
+        monitor.reportLeaks();
+        if (monitor.m_profileFile != nullptr
+            && ! monitor.writeProfile(
+                monitor.m_profileFile,
+                monitor.m_profileOrder
+            )) {
+            std::cerr << "Failed to write heap profile: "
+                      << monitor.m_profileFile << "\n";
+        }
+    });
+}
+
+HeapShard *HeapMonitor::getShard() {
+    if (t_shard == nullptr && ! t_exited) {
+        thread_local ThreadShard guard;
+        t_shard = acquireShard();
+    }
+    return t_shard;
+}
+
+HeapShard *HeapMonitor::acquireShard() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (HeapShard *shard = m_shards.load(std::memory_order_relaxed); shard;
+         shard = shard->m_nextShard) {
+        if (shard->m_abandoned) {
+            shard->m_abandoned = false;
+            return shard;
+        }
+    }
+
+    // Shards are never freed, blocks may still point to them
+    void *memory = std::malloc(sizeof(HeapShard));
+    if (! memory) {
+        return nullptr;
+    }
+    HeapShard *shard = ::new (memory) HeapShard();
+    shard->m_nextShard = m_shards.load(std::memory_order_relaxed);
+    m_shards.store(shard, std::memory_order_release);
+    return shard;
 }
+
+void HeapMonitor::abandonShard(HeapShard *shard) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    shard->m_abandoned = true;
+}
+
+void HeapMonitor::countEvent() {
+    if (m_profiling.load(std::memory_order_relaxed)
+        && ++t_eventCount % k_sampleStride == 0) {
+        sampleTimeline();
+    }
+}
+
+void HeapMonitor::sampleTimeline() {
+    if (m_timelineLocked.test_and_set(std::memory_order_acquire)) {
+        return;
+    }
+
+    const std::chrono::nanoseconds now
+        = std::chrono::steady_clock::now() - m_start;
+    if (now >= m_nextSample) {
+        if (m_timelineCount == k_timelineCapacity) {
+            for (std::size_t i = 0; i < k_timelineCapacity / 2; ++i) {
+                m_timeline[i] = m_timeline[2 * i];
+            }
+            m_timelineCount = k_timelineCapacity / 2;
+            m_sampleInterval *= 2;
+        }
+        m_timeline[m_timelineCount++] = {
+            std::chrono::duration<double>(now).count(),
+            getLiveBytes()
+        };
+        m_nextSample = now + m_sampleInterval;
+    }
+    m_timelineLocked.clear(std::memory_order_release);
+}
+
+void HeapMonitor::lockTimeline() {
+    while (m_timelineLocked.test_and_set(std::memory_order_acquire)) {
+        std::this_thread::yield();
+    }
+}
+
+} // namespace details
+
+} // namespace fri
+
+#endif // NDEBUG
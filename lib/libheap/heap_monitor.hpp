@@ -3,14 +3,50 @@
 
 #ifndef NDEBUG
 
+#include "heap_sampler.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
-#include <map>
+#include <mutex>
+#include <new>
 #include <string>
+#include <vector>
 
 namespace fri {
 
 namespace details {
 
+class HeapShard;
+struct BlockHeader;
+
+struct HeapSiteProfile {
+    std::string file;
+    int line;
+    std::uint64_t count;
+    std::uint64_t bytes;
+    std::uint64_t liveBytes;
+    // Summed over the threads allocating at the site, so it is exact only
+    // for sites used by a single thread
+    std::uint64_t peakLiveBytes;
+};
+
+struct HeapTimelineSample {
+    double seconds;
+    std::size_t liveBytes;
+};
+
+// Every block from operator new carries a header naming the shard of the
+// thread that allocated it. Each thread records its blocks in its own shard,
+// the shards are merged only to report. Blocks allocated without the new
+// macro are not tracked, but may be sampled by the HeapSampler.
+//
+// Every call site keeps the count and bytes of its allocations. Profiling
+// adds a timeline of the live bytes of the whole process. Setting the
+// environment variable FRI_HEAP_PROFILE to a file name turns profiling on
+// at startup and writes the profile into the file at exit, sorted by bytes
+// or, with FRI_HEAP_PROFILE_ORDER=count, by count.
 class HeapMonitor {
 public:
     HeapMonitor(const HeapMonitor &) = delete;
@@ -18,21 +54,68 @@ public:
     HeapMonitor(HeapMonitor &&) = delete;
     void operator= (HeapMonitor &&) = delete;
 
-    static HeapMonitor &getInstance() {
-        static HeapMonitor instance;
-        return instance;
-    }
+    // The monitor is never destroyed, deletions by destructors of other
+    // static objects run after the leak report.
+    static HeapMonitor &getInstance();
 
 public:
-    ~HeapMonitor();
-    void logAllocation(void *p, std::string file, int line);
-    void logDeletion(void *p);
+    // Called by operator new for blocks allocated through the new macro.
+    void track(BlockHeader *header, const char *file, int line);
+    // Called by operator delete for tracked blocks. Returns false if the
+    // block belongs to another thread, which then frees it.
+    bool untrack(BlockHeader *header);
+
+    std::size_t countLiveBlocks();
+    std::size_t getLiveBytes();
+
+    // Prints the call sites of all blocks still allocated, called at exit.
+    void reportLeaks();
+
+    void setProfiling(bool enabled);
+    bool isProfiling() const;
+
+    std::vector<HeapSiteProfile> getSiteProfiles(HeapProfileOrder order);
+    std::vector<HeapTimelineSample> getTimeline();
+    // Includes the sampled stacks. Returns false if the file could not be
+    // written.
+    bool writeProfile(const char *fileName, HeapProfileOrder order);
 
 private:
-    HeapMonitor() = default;
+    struct ThreadShard;
+
+    // Once the timeline is full, every other sample is dropped and the
+    // interval doubles, so it always spans the whole run
+    static constexpr std::size_t k_timelineCapacity = 2048;
+    static constexpr std::chrono::nanoseconds k_initialSampleInterval
+        = std::chrono::milliseconds(1);
+    // Allocations and deletions of a thread between looking at the clock
+    static constexpr unsigned k_sampleStride = 256;
+
+    HeapMonitor();
+
+    HeapShard *getShard();
+    HeapShard *acquireShard();
+    void abandonShard(HeapShard *shard);
+
+    void countEvent();
+    void sampleTimeline();
+    void lockTimeline();
 
 private:
-    std::map<std::intptr_t, std::string> m_allocations;
+    std::mutex m_mutex;
+    std::atomic<HeapShard *> m_shards;
+
+    std::atomic<bool> m_profiling;
+    const char *m_profileFile;
+    HeapProfileOrder m_profileOrder;
+
+    // Guarded by the flag, threads skip sampling while it is taken
+    std::atomic_flag m_timelineLocked;
+    std::chrono::steady_clock::time_point m_start;
+    std::chrono::nanoseconds m_sampleInterval;
+    std::chrono::nanoseconds m_nextSample;
+    HeapTimelineSample m_timeline[k_timelineCapacity];
+    std::size_t m_timelineCount;
 };
 
 } // namespace details
@@ -41,6 +124,41 @@ private:
 
 void *operator new (std::size_t sz, const char *file, int line);
 
+void *operator new[] (std::size_t sz, const char *file, int line);
+
+void *operator new (
+    std::size_t sz,
+    std::align_val_t alignment,
+    const char *file,
+    int line
+);
+
+void *operator new[] (
+    std::size_t sz,
+    std::align_val_t alignment,
+    const char *file,
+    int line
+);
+
+// Called only if the constructor of an object allocated above throws
+void operator delete (void *p, const char *file, int line) noexcept;
+
+void operator delete[] (void *p, const char *file, int line) noexcept;
+
+void operator delete (
+    void *p,
+    std::align_val_t alignment,
+    const char *file,
+    int line
+) noexcept;
+
+void operator delete[] (
+    void *p,
+    std::align_val_t alignment,
+    const char *file,
+    int line
+) noexcept;
+
 void operator delete (void *p) noexcept;
 
 void operator delete (void *p, std::size_t n) noexcept;
@@ -0,0 +1,246 @@
+#include "heap_monitor.hpp"
+
+#undef new
+
+#include "block.hpp"
+#include "heap_sampler.hpp"
+#include "heap_stats.hpp"
+#include "heap_switches.hpp"
+
+#include <cstddef>
+#include <new>
+
+// Every form of operator new and delete, in all builds. The HeapMonitor only
+// exists in debug builds, the sampler and the statistics in both.
+//
+// Every block carries a 16 byte BlockHeader, release builds included. It is
+// a deliberate cost: the sampler and the statistics can be switched on at
+// any time, and blocks allocated before must still be freed correctly. It
+// also keeps blocks aligned for any type.
+
+namespace {
+
+using namespace ::fri::details;
+using ::fri::HeapStats;
+
+constexpr std::size_t k_defaultAlignment = alignof(std::max_align_t);
+
+// Blocks allocated without a file are not tracked by the HeapMonitor
+void *allocate(
+    std::size_t size,
+    std::size_t alignment,
+    const char *file,
+    int line
+) {
+    BlockHeader *header = allocateBlock(size, alignment);
+    if (! header) {
+        return nullptr;
+    }
+
+    // The header starts with neither a stack nor counted
+    if (HeapSwitches::get() != 0) {
+        header->stack = HeapSampler::getInstance().sample(size);
+        header->counted = HeapStats::recordAllocation(size);
+    }
+#ifndef NDEBUG
+    if (file != nullptr) {
+        HeapMonitor::getInstance().track(header, file, line);
+    }
+#else
+    (void)file;
+    (void)line;
+#endif
+    return getUserPointer(header);
+}
+
+void *allocateOrThrow(
+    std::size_t sz,
+    std::size_t alignment,
+    const char *file,
+    int line
+) {
+    void *p = allocate(sz, alignment, file, line);
+    if (! p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void *allocateOrNull(std::size_t sz, std::size_t alignment) noexcept {
+    return allocate(sz, alignment, nullptr, 0);
+}
+
+void deallocate(void *p) noexcept {
+    if (p == nullptr) {
+        return;
+    }
+
+    BlockHeader *header = getHeader(p);
+    HeapSampler::getInstance().release(header->stack, header->size);
+    if (header->counted) {
+        HeapStats::recordFree(header->size);
+    }
+#ifndef NDEBUG
+    // Blocks of other threads are freed by their owner
+    if (header->owner != nullptr
+        && ! HeapMonitor::getInstance().untrack(header)) {
+        return;
+    }
+#endif
+    freeBlock(header);
+}
+
+} // namespace
+
+#ifndef NDEBUG
+
+void *operator new (std::size_t sz, const char *file, int line) {
+    return allocateOrThrow(sz, k_defaultAlignment, file, line);
+}
+
+void *operator new[] (std::size_t sz, const char *file, int line) {
+    return allocateOrThrow(sz, k_defaultAlignment, file, line);
+}
+
+void *operator new (
+    std::size_t sz,
+    std::align_val_t alignment,
+    const char *file,
+    int line
+) {
+    return allocateOrThrow(sz, static_cast<std::size_t>(alignment), file, line);
+}
+
+void *operator new[] (
+    std::size_t sz,
+    std::align_val_t alignment,
+    const char *file,
+    int line
+) {
+    return allocateOrThrow(sz, static_cast<std::size_t>(alignment), file, line);
+}
+
+void operator delete (void *p, const char *, int) noexcept {
+    deallocate(p);
+}
+
+void operator delete[] (void *p, const char *, int) noexcept {
+    deallocate(p);
+}
+
+void operator delete (void *p, std::align_val_t, const char *, int) noexcept {
+    deallocate(p);
+}
+
+void operator delete[] (
+    void *p,
+    std::align_val_t,
+    const char *,
+    int
+) noexcept {
+    deallocate(p);
+}
+
+#endif // NDEBUG
+
+// Blocks allocated anywhere else are deleted by the same operators, so they
+// need the header as well, in release builds too
+
+void *operator new (std::size_t sz) {
+    return allocateOrThrow(sz, k_defaultAlignment, nullptr, 0);
+}
+
+void *operator new[] (std::size_t sz) {
+    return allocateOrThrow(sz, k_defaultAlignment, nullptr, 0);
+}
+
+void *operator new (std::size_t sz, std::align_val_t alignment) {
+    return allocateOrThrow(sz, static_cast<std::size_t>(alignment), nullptr, 0);
+}
+
+void *operator new[] (std::size_t sz, std::align_val_t alignment) {
+    return allocateOrThrow(sz, static_cast<std::size_t>(alignment), nullptr, 0);
+}
+
+void *operator new (std::size_t sz, const std::nothrow_t &) noexcept {
+    return allocateOrNull(sz, k_defaultAlignment);
+}
+
+void *operator new[] (std::size_t sz, const std::nothrow_t &) noexcept {
+    return allocateOrNull(sz, k_defaultAlignment);
+}
+
+void *operator new (
+    std::size_t sz,
+    std::align_val_t alignment,
+    const std::nothrow_t &
+) noexcept {
+    return allocateOrNull(sz, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[] (
+    std::size_t sz,
+    std::align_val_t alignment,
+    const std::nothrow_t &
+) noexcept {
+    return allocateOrNull(sz, static_cast<std::size_t>(alignment));
+}
+
+// The header tells how the block was allocated, so every form of delete
+// ends up in the same place
+
+void operator delete (void *p) noexcept {
+    deallocate(p);
+}
+
+void operator delete[] (void *p) noexcept {
+    deallocate(p);
+}
+
+void operator delete (void *p, std::size_t) noexcept {
+    deallocate(p);
+}
+
+void operator delete[] (void *p, std::size_t) noexcept {
+    deallocate(p);
+}
+
+void operator delete (void *p, std::align_val_t) noexcept {
+    deallocate(p);
+}
+
+void operator delete[] (void *p, std::align_val_t) noexcept {
+    deallocate(p);
+}
+
+void operator delete (void *p, std::size_t, std::align_val_t) noexcept {
+    deallocate(p);
+}
+
+void operator delete[] (void *p, std::size_t, std::align_val_t) noexcept {
+    deallocate(p);
+}
+
+void operator delete (void *p, const std::nothrow_t &) noexcept {
+    deallocate(p);
+}
+
+void operator delete[] (void *p, const std::nothrow_t &) noexcept {
+    deallocate(p);
+}
+
+void operator delete (
+    void *p,
+    std::align_val_t,
+    const std::nothrow_t &
+) noexcept {
+    deallocate(p);
+}
+
+void operator delete[] (
+    void *p,
+    std::align_val_t,
+    const std::nothrow_t &
+) noexcept {
+    deallocate(p);
+}
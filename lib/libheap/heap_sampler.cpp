@@ -0,0 +1,426 @@
+#include "heap_sampler.hpp"
+#include "heap_switches.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif __has_include(<execinfo.h>)
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <execinfo.h>
+#define HEAP_HAS_EXECINFO
+#endif
+
+namespace fri {
+
+namespace details {
+
+namespace {
+
+constexpr std::size_t k_initialIndexCapacity = 256;
+
+thread_local std::int64_t t_countdown = 0;
+thread_local std::uint64_t t_random = 0;
+
+// Set while the thread is inside the sampler, so that the allocations made
+// by walking the stack or reporting are not sampled in turn
+thread_local bool t_sampling = false;
+
+std::int64_t nextInterval(unsigned rate) {
+    if (rate <= 1) {
+        return 1;
+    }
+    if (t_random == 0) {
+        t_random = reinterpret_cast<std::uintptr_t>(&t_random)
+                   | 0x9E3779B97F4A7C15ull;
+    }
+    t_random ^= t_random >> 12;
+    t_random ^= t_random << 25;
+    t_random ^= t_random >> 27;
+    const std::uint64_t bits = t_random * 0x2545F4914F6CDD1Dull;
+
+    // Exponentially distributed with a mean of the rate
+    const double uniform = ((bits >> 11) + 1) * 0x1.0p-53;
+    return std::max<std::int64_t>(
+        1,
+        static_cast<std::int64_t>(std::ceil(-std::log(uniform) * rate))
+    );
+}
+
+int captureStack(void **frames, int maxDepth) {
+#if defined(_WIN32)
+    return CaptureStackBackTrace(0, maxDepth, frames, nullptr);
+#elif defined(HEAP_HAS_EXECINFO)
+    return backtrace(frames, maxDepth);
+#else
+    (void)frames;
+    (void)maxDepth;
+    return 0;
+#endif
+}
+
+std::string describeFrame(void *frame) {
+    char buffer[64];
+#if defined(HEAP_HAS_EXECINFO)
+    Dl_info info;
+    if (dladdr(frame, &info) && info.dli_fname != nullptr) {
+        const char *base = static_cast<const char *>(
+            info.dli_sname != nullptr ? info.dli_saddr : info.dli_fbase
+        );
+        std::snprintf(
+            buffer,
+            sizeof(buffer),
+            "+0x%zx",
+            static_cast<std::size_t>(static_cast<const char *>(frame) - base)
+        );
+
+        std::string name;
+        if (info.dli_sname != nullptr) {
+            int status;
+            char *demangled = abi::__cxa_demangle(
+                info.dli_sname,
+                nullptr,
+                nullptr,
+                &status
+            );
+            name = status == 0 ? demangled : info.dli_sname;
+            std::free(demangled);
+            return name + buffer + " (" + info.dli_fname + ")";
+        }
+        return info.dli_fname + std::string(buffer);
+    }
+#endif
+    std::snprintf(buffer, sizeof(buffer), "%p", frame);
+    return buffer;
+}
+
+// Frames of the allocator itself are dropped from the top of every stack.
+// Its internal functions have no name, so everything up to operator new
+// goes.
+std::size_t countAllocatorFrames(const std::vector<std::string> &frames) {
+    for (std::size_t i = 0; i < frames.size(); ++i) {
+        if (frames[i].rfind("operator new", 0) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+bool isLibraryFrame(const std::string &frame) {
+    return frame.rfind("std::", 0) == 0
+           || frame.rfind("__gnu_cxx::", 0) == 0;
+}
+
+} // namespace
+
+struct HeapSampler::Stack {
+    std::uint64_t hash;
+    int depth;
+    void *frames[k_maxDepth];
+    std::uint64_t count;
+    std::uint64_t bytes;
+    std::uint64_t liveCount;
+    std::uint64_t liveBytes;
+};
+
+HeapSampler &HeapSampler::getInstance() {
+    alignas(HeapSampler) static unsigned char storage[sizeof(HeapSampler)];
+    static HeapSampler *instance = ::new (storage) HeapSampler();
+    return *instance;
+}
+
+void HeapSampler::setSampleRate(unsigned rate) {
+    m_rate.store(rate, std::memory_order_relaxed);
+    HeapSwitches::set(HeapSwitches::k_sampler, rate != 0);
+}
+
+unsigned HeapSampler::getSampleRate() const {
+    return m_rate.load(std::memory_order_relaxed);
+}
+
+std::vector<HeapStackProfile> HeapSampler::getStackProfiles(
+    HeapProfileOrder order
+) {
+    // The stacks are copied out, so the lock is not held while allocating
+    Stack *stacks = nullptr;
+    std::uint32_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stacks = static_cast<Stack *>(std::malloc(m_count * sizeof(Stack)));
+        if (stacks != nullptr) {
+            count = m_count;
+            std::memcpy(stacks, m_stacks, count * sizeof(Stack));
+        }
+    }
+
+    const bool wasSampling = t_sampling;
+    t_sampling = true;
+    std::vector<HeapStackProfile> profiles;
+    profiles.reserve(count);
+    for (std::uint32_t i = 0; i < count; ++i) {
+        const Stack &stack = stacks[i];
+        HeapStackProfile profile = {
+            {},
+            stack.count,
+            stack.bytes,
+            stack.liveCount,
+            stack.liveBytes
+        };
+        for (int j = 0; j < stack.depth; ++j) {
+            profile.frames.push_back(describeFrame(stack.frames[j]));
+        }
+        profile.frames.erase(
+            profile.frames.begin(),
+            profile.frames.begin() + countAllocatorFrames(profile.frames)
+        );
+        if (stack.depth == 0) {
+            profile.frames.push_back("(further stacks)");
+        }
+        profiles.push_back(std::move(profile));
+    }
+    std::free(stacks);
+
+    std::sort(
+        profiles.begin(),
+        profiles.end(),
+        [order](const HeapStackProfile &a, const HeapStackProfile &b) {
+            return order == HeapProfileOrder::Count ? a.count > b.count
+                                                    : a.bytes > b.bytes;
+        }
+    );
+    t_sampling = wasSampling;
+    return profiles;
+}
+
+std::size_t HeapSampler::getTopStacks(
+    HeapStackSummary *stacks,
+    std::size_t maxCount
+) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const std::size_t count = std::min<std::size_t>(maxCount, m_topCount);
+    for (std::size_t i = 0; i < count; ++i) {
+        const Stack &stack = m_stacks[m_top[i] - 1];
+        stacks[i] = {
+            m_top[i],
+            stack.count,
+            stack.bytes,
+            stack.liveCount,
+            stack.liveBytes
+        };
+    }
+    return count;
+}
+
+std::string HeapSampler::describeCaller(std::uint16_t stack) {
+    void *frames[k_maxDepth];
+    int depth = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (stack != 0 && stack <= m_count) {
+            depth = m_stacks[stack - 1].depth;
+            std::copy(
+                m_stacks[stack - 1].frames,
+                m_stacks[stack - 1].frames + depth,
+                frames
+            );
+        }
+    }
+    if (depth == 0) {
+        return "(further stacks)";
+    }
+
+    const bool wasSampling = t_sampling;
+    t_sampling = true;
+    std::vector<std::string> names;
+    for (int i = 0; i < depth; ++i) {
+        names.push_back(describeFrame(frames[i]));
+    }
+    std::size_t caller
+        = std::min(countAllocatorFrames(names), names.size() - 1);
+    for (std::size_t i = caller; i < names.size(); ++i) {
+        if (! isLibraryFrame(names[i])) {
+            caller = i;
+            break;
+        }
+    }
+    std::string name = std::move(names[caller]);
+    t_sampling = wasSampling;
+    return name;
+}
+
+HeapSampler::HeapSampler() :
+    m_rate(0),
+    m_mutex(),
+    m_stacks(nullptr),
+    m_count(0),
+    m_index(nullptr),
+    m_capacity(0),
+    m_top(),
+    m_topCount(0) {
+    const char *rate = std::getenv("FRI_HEAP_SAMPLE");
+    if (rate != nullptr) {
+        setSampleRate(static_cast<unsigned>(std::strtoul(rate, nullptr, 10)));
+    }
+}
+
+std::uint16_t HeapSampler::countDown(std::size_t size) {
+    const unsigned rate = m_rate.load(std::memory_order_relaxed);
+    if (rate == 0 || t_sampling || --t_countdown > 0) {
+        return 0;
+    }
+    t_countdown = nextInterval(rate);
+    return record(size);
+}
+
+std::uint16_t HeapSampler::record(std::size_t size) {
+    t_sampling = true;
+    void *frames[k_maxDepth];
+    const int depth = captureStack(frames, k_maxDepth);
+    std::uint64_t hash = 0xCBF29CE484222325ull;
+    for (int i = 0; i < depth; ++i) {
+        hash = (hash ^ reinterpret_cast<std::uintptr_t>(frames[i]))
+               * 0x100000001B3ull;
+    }
+
+    std::uint16_t id = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        id = static_cast<std::uint16_t>(intern(frames, depth, hash));
+        if (id != 0) {
+            Stack &stack = m_stacks[id - 1];
+            ++stack.count;
+            stack.bytes += size;
+            ++stack.liveCount;
+            stack.liveBytes += size;
+            rank(id);
+        }
+    }
+    t_sampling = false;
+    return id;
+}
+
+void HeapSampler::releaseSampled(std::uint16_t stack, std::size_t size) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stack &entry = m_stacks[stack - 1];
+    --entry.liveCount;
+    entry.liveBytes -= size;
+}
+
+void HeapSampler::rank(std::uint16_t id) {
+    // Bytes only grow, so a stack enters the ranking once it outweighs the
+    // last one there and then only moves up, which keeps it exact
+    std::uint32_t i = 0;
+    while (i < m_topCount && m_top[i] != id) {
+        ++i;
+    }
+    const std::uint64_t bytes = m_stacks[id - 1].bytes;
+    if (i == m_topCount) {
+        if (m_topCount < k_topStackCount) {
+            ++m_topCount;
+        } else if (bytes <= m_stacks[m_top[i - 1] - 1].bytes) {
+            return;
+        }
+        i = m_topCount - 1;
+    }
+    for (; i > 0 && m_stacks[m_top[i - 1] - 1].bytes < bytes; --i) {
+        m_top[i] = m_top[i - 1];
+    }
+    m_top[i] = id;
+}
+
+std::uint32_t HeapSampler::intern(
+    void *const *frames,
+    int depth,
+    std::uint64_t hash
+) {
+    if (m_count >= m_capacity / 2) {
+        grow();
+        if (m_count >= m_capacity / 2) {
+            return 0;
+        }
+    }
+
+    const std::size_t mask = m_capacity - 1;
+    std::size_t i = static_cast<std::size_t>(hash) & mask;
+    for (; m_index[i] != 0; i = (i + 1) & mask) {
+        const Stack &stack = m_stacks[m_index[i] - 1];
+        if (stack.hash == hash && stack.depth == depth
+            && std::equal(frames, frames + depth, stack.frames)) {
+            return m_index[i];
+        }
+    }
+
+    // The last id is not indexed, it takes every stack once all others
+    // are used
+    if (m_count + 1 >= k_maxStackCount) {
+        if (m_count + 1 == k_maxStackCount) {
+            m_stacks[m_count++] = {0, 0, {}, 0, 0, 0, 0};
+        }
+        return k_maxStackCount;
+    }
+
+    Stack &stack = m_stacks[m_count];
+    stack = {hash, depth, {}, 0, 0, 0, 0};
+    std::copy(frames, frames + depth, stack.frames);
+    m_index[i] = ++m_count;
+    return m_index[i];
+}
+
+void HeapSampler::grow() {
+    const std::size_t capacity
+        = m_capacity == 0 ? k_initialIndexCapacity : m_capacity * 2;
+    Stack *stacks = static_cast<Stack *>(
+        std::realloc(m_stacks, capacity / 2 * sizeof(Stack))
+    );
+    if (stacks == nullptr) {
+        return;
+    }
+    m_stacks = stacks;
+
+    std::uint32_t *index = static_cast<std::uint32_t *>(
+        std::calloc(capacity, sizeof(std::uint32_t))
+    );
+    if (index == nullptr) {
+        return;
+    }
+
+    const std::size_t mask = capacity - 1;
+    for (std::uint32_t id = 1; id <= m_count && id < k_maxStackCount; ++id) {
+        std::size_t i = static_cast<std::size_t>(m_stacks[id - 1].hash) & mask;
+        while (index[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        index[i] = id;
+    }
+
+    std::free(m_index);
+    m_index = index;
+    m_capacity = capacity;
+}
+
+namespace {
+
+// operator new only asks for the sampler once it is switched on, so the
+// environment is read before main, like the one of the HeapStats
+struct EnvironmentSwitch {
+    EnvironmentSwitch() {
+        HeapSampler::getInstance();
+    }
+};
+
+const EnvironmentSwitch g_environmentSwitch;
+
+} // namespace
+
+} // namespace details
+
+} // namespace fri
@@ -0,0 +1,124 @@
+#ifndef HEAP_HEAP_SAMPLER_HPP
+#define HEAP_HEAP_SAMPLER_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fri {
+
+namespace details {
+
+enum class HeapProfileOrder {
+    Bytes,
+    Count
+};
+
+struct HeapStackProfile {
+    // Innermost first, as "function+offset (module)" or a bare address
+    std::vector<std::string> frames;
+    std::uint64_t count;
+    std::uint64_t bytes;
+    std::uint64_t liveCount;
+    std::uint64_t liveBytes;
+};
+
+// Totals of one sampled stack, without its frames
+struct HeapStackSummary {
+    std::uint16_t stack;
+    std::uint64_t count;
+    std::uint64_t bytes;
+    std::uint64_t liveCount;
+    std::uint64_t liveBytes;
+};
+
+// Captures the native stack trace of about one in every N allocations and
+// sums the sampled allocations up per distinct stack. Intervals between
+// samples are random, so allocation patterns cannot line up with them.
+//
+// When disabled, operator new does not call it, see HeapSwitches. Otherwise
+// an allocation costs a thread local countdown, only the sampled ones take
+// a lock and walk the stack. Names are resolved when reporting, only
+// exported functions have one, other frames show their module and offset
+// for addr2line.
+//
+// The stacks with the most sampled bytes are ranked as they are recorded,
+// so reading the top ones copies a few entries and allocates nothing.
+//
+// The environment variable FRI_HEAP_SAMPLE sets the rate at startup.
+class HeapSampler {
+public:
+    HeapSampler(const HeapSampler &) = delete;
+    void operator= (const HeapSampler &) = delete;
+
+    // Never destroyed, like the HeapMonitor
+    static HeapSampler &getInstance();
+
+public:
+    // Zero turns sampling off, one samples every allocation.
+    void setSampleRate(unsigned rate);
+    unsigned getSampleRate() const;
+
+    // Returns the stack id to keep with the block, zero if not sampled.
+    std::uint16_t sample(std::size_t size) {
+        if (m_rate.load(std::memory_order_relaxed) == 0) {
+            return 0;
+        }
+        return countDown(size);
+    }
+
+    void release(std::uint16_t stack, std::size_t size) {
+        if (stack != 0) {
+            releaseSampled(stack, size);
+        }
+    }
+
+    std::vector<HeapStackProfile> getStackProfiles(HeapProfileOrder order);
+
+    // Copies up to k_topStackCount stacks with the most sampled bytes,
+    // heaviest first, into the array. Returns how many were copied.
+    std::size_t getTopStacks(HeapStackSummary *stacks, std::size_t maxCount);
+    // Innermost frame of the stack outside the allocator and the standard
+    // library, named like in the profiles.
+    std::string describeCaller(std::uint16_t stack);
+
+    static constexpr std::size_t k_topStackCount = 16;
+
+private:
+    struct Stack;
+
+    static constexpr int k_maxDepth = 32;
+    // Stack ids have 16 bits, the last one collects all further stacks
+    static constexpr std::uint32_t k_maxStackCount = 0xFFFF;
+
+    HeapSampler();
+
+    std::uint16_t countDown(std::size_t size);
+    std::uint16_t record(std::size_t size);
+    void releaseSampled(std::uint16_t stack, std::size_t size);
+    void rank(std::uint16_t id);
+    std::uint32_t intern(void *const *frames, int depth, std::uint64_t hash);
+    void grow();
+
+private:
+    std::atomic<unsigned> m_rate;
+
+    std::mutex m_mutex;
+    Stack *m_stacks;
+    std::uint32_t m_count;
+    // Open addressing index of ids into m_stacks, zero marks an empty slot
+    std::uint32_t *m_index;
+    std::size_t m_capacity;
+    // Ids of the stacks with the most bytes, heaviest first
+    std::uint16_t m_top[k_topStackCount];
+    std::uint32_t m_topCount;
+};
+
+} // namespace details
+
+} // namespace fri
+
+#endif // HEAP_HEAP_SAMPLER_HPP
@@ -0,0 +1,91 @@
+#include "heap_shard.hpp"
+
+namespace fri {
+
+namespace details {
+
+HeapShard::HeapShard() :
+    m_lock(),
+    m_sites(),
+    m_allocations(),
+    m_remote(nullptr),
+    m_liveBytes(0),
+    m_nextShard(nullptr),
+    m_abandoned(false) {
+}
+
+void HeapShard::insert(BlockHeader *header, const char *file, int line) {
+    std::lock_guard<SpinLock> lock(m_lock);
+    drainRemote();
+    const std::uint32_t id = m_sites.intern(file, line);
+    m_allocations.insert(header, id);
+
+    SiteStats &stats = m_sites.get(id).stats;
+    ++stats.count;
+    stats.bytes += header->size;
+    stats.liveBytes += header->size;
+    if (stats.liveBytes > stats.peakLiveBytes) {
+        stats.peakLiveBytes = stats.liveBytes;
+    }
+    m_liveBytes.store(
+        m_liveBytes.load(std::memory_order_relaxed) + header->size,
+        std::memory_order_relaxed
+    );
+}
+
+void HeapShard::erase(BlockHeader *header) {
+    std::lock_guard<SpinLock> lock(m_lock);
+    drainRemote();
+    release(header);
+}
+
+void HeapShard::pushRemote(BlockHeader *header) {
+    header->next = m_remote.load(std::memory_order_relaxed);
+    while (! m_remote.compare_exchange_weak(
+        header->next,
+        header,
+        std::memory_order_release,
+        std::memory_order_relaxed
+    )) {
+    }
+}
+
+std::size_t HeapShard::countBlocks() {
+    std::lock_guard<SpinLock> lock(m_lock);
+    drainRemote();
+    return m_allocations.size();
+}
+
+std::size_t HeapShard::getLiveBytes() const {
+    return m_liveBytes.load(std::memory_order_relaxed);
+}
+
+void HeapShard::drainRemote() {
+    // The whole stack is taken at once, so popping needs no ABA protection
+    if (m_remote.load(std::memory_order_relaxed) == nullptr) {
+        return;
+    }
+    BlockHeader *header = m_remote.exchange(nullptr, std::memory_order_acquire);
+    while (header != nullptr) {
+        BlockHeader *next = header->next;
+        release(header);
+        freeBlock(header);
+        header = next;
+    }
+}
+
+void HeapShard::release(BlockHeader *header) {
+    std::uint32_t id;
+    if (! m_allocations.erase(header, &id)) {
+        return;
+    }
+    m_sites.get(id).stats.liveBytes -= header->size;
+    m_liveBytes.store(
+        m_liveBytes.load(std::memory_order_relaxed) - header->size,
+        std::memory_order_relaxed
+    );
+}
+
+} // namespace details
+
+} // namespace fri
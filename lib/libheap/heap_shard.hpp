@@ -0,0 +1,106 @@
+#ifndef HEAP_HEAP_SHARD_HPP
+#define HEAP_HEAP_SHARD_HPP
+
+#include "allocation_table.hpp"
+#include "block.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace fri {
+
+namespace details {
+
+// Lock for data that is nearly always touched by one thread only, taking it
+// uncontended costs a single atomic exchange.
+class SpinLock {
+public:
+    void lock() {
+        while (m_locked.exchange(true, std::memory_order_acquire)) {
+            while (m_locked.load(std::memory_order_relaxed)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void unlock() {
+        m_locked.store(false, std::memory_order_release);
+    }
+
+private:
+    std::atomic<bool> m_locked = false;
+};
+
+// ==================================================
+
+// Blocks allocated by one thread. Only the owning thread inserts and erases,
+// the lock is taken by others just while reporting, so it is uncontended.
+// Blocks deleted by other threads are pushed onto a lock-free stack and
+// freed by the owner the next time it touches the shard.
+//
+// A shard outlives its thread. Once the thread exits, the shard is abandoned
+// and adopted by the next thread that starts allocating.
+class HeapShard {
+public:
+    HeapShard();
+    HeapShard(const HeapShard &) = delete;
+    void operator= (const HeapShard &) = delete;
+
+public:
+    void insert(BlockHeader *header, const char *file, int line);
+    void erase(BlockHeader *header);
+    void pushRemote(BlockHeader *header);
+
+    // Calls the function with the file and line of every live block.
+    template<class Function>
+    void forEachBlock(Function function) {
+        std::lock_guard<SpinLock> lock(m_lock);
+        drainRemote();
+        m_allocations.forEach([this, &function](std::uint32_t id) {
+            const CallSite &site = m_sites.get(id);
+            function(site.file, site.line);
+        });
+    }
+
+    // Calls the function with every call site and its statistics.
+    template<class Function>
+    void forEachSite(Function function) {
+        std::lock_guard<SpinLock> lock(m_lock);
+        drainRemote();
+        for (std::uint32_t id = 0; id < m_sites.size(); ++id) {
+            function(m_sites.get(id));
+        }
+    }
+
+    std::size_t countBlocks();
+
+    // Bytes of the live blocks, may be read without the lock.
+    std::size_t getLiveBytes() const;
+
+private:
+    friend class HeapMonitor;
+
+    void drainRemote();
+    void release(BlockHeader *header);
+
+private:
+    SpinLock m_lock;
+    CallSiteTable m_sites;
+    AllocationTable m_allocations;
+    std::atomic<BlockHeader *> m_remote;
+    std::atomic<std::size_t> m_liveBytes;
+
+    // The next shard is set before the shard is published, whether it is
+    // abandoned is guarded by the mutex of the HeapMonitor
+    HeapShard *m_nextShard;
+    bool m_abandoned;
+};
+
+} // namespace details
+
+} // namespace fri
+
+#endif // HEAP_HEAP_SHARD_HPP
@@ -0,0 +1,111 @@
+#include "heap_stats.hpp"
+
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+
+namespace fri {
+
+namespace {
+
+std::atomic<std::uint64_t> g_allocations(0);
+std::atomic<std::uint64_t> g_frees(0);
+std::atomic<std::uint64_t> g_liveBytes(0);
+std::atomic<std::uint64_t> g_peakBytes(0);
+std::atomic<std::uint64_t> g_sizeClasses[k_heapSizeClassCount] = {};
+
+int getSizeClass(std::size_t size) {
+    if (size <= 8) {
+        return 0;
+    }
+    const int sizeClass = std::bit_width(size - 1) - 3;
+    return sizeClass < k_heapSizeClassCount ? sizeClass
+                                            : k_heapSizeClassCount - 1;
+}
+
+// Reads the environment before main, allocations made earlier by other
+// static initializers are not counted
+struct EnvironmentSwitch {
+    EnvironmentSwitch() {
+        const char *value = std::getenv("FRI_HEAP_STATS");
+        if (value == nullptr || *value == '\0'
+            || std::strcmp(value, "0") == 0) {
+            return;
+        }
+        HeapStats::setHistogramEnabled(std::strcmp(value, "histogram") == 0);
+        HeapStats::setEnabled(true);
+    }
+};
+
+const EnvironmentSwitch g_environmentSwitch;
+
+} // namespace
+
+std::atomic<bool> HeapStats::s_histogramEnabled(false);
+
+void HeapStats::setEnabled(bool enabled) {
+    details::HeapSwitches::set(details::HeapSwitches::k_stats, enabled);
+}
+
+bool HeapStats::isEnabled() {
+    return (details::HeapSwitches::get() & details::HeapSwitches::k_stats)
+           != 0;
+}
+
+void HeapStats::setHistogramEnabled(bool enabled) {
+    s_histogramEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool HeapStats::isHistogramEnabled() {
+    return s_histogramEnabled.load(std::memory_order_relaxed);
+}
+
+HeapStatsSnapshot HeapStats::getSnapshot() {
+    HeapStatsSnapshot snapshot = {
+        g_allocations.load(std::memory_order_relaxed),
+        g_frees.load(std::memory_order_relaxed),
+        g_liveBytes.load(std::memory_order_relaxed),
+        g_peakBytes.load(std::memory_order_relaxed),
+        {}
+    };
+    for (int i = 0; i < k_heapSizeClassCount; ++i) {
+        snapshot.sizeClasses[i]
+            = g_sizeClasses[i].load(std::memory_order_relaxed);
+    }
+    return snapshot;
+}
+
+std::size_t HeapStats::getSizeClassLimit(int sizeClass) {
+    return sizeClass < k_heapSizeClassCount - 1 ? std::size_t(8) << sizeClass
+                                                : 0;
+}
+
+void HeapStats::recordFree(std::size_t size) {
+    g_frees.fetch_add(1, std::memory_order_relaxed);
+    g_liveBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+void HeapStats::countAllocation(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    const std::uint64_t live
+        = g_liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+
+    // The peak only needs a write while it is being exceeded
+    std::uint64_t peak = g_peakBytes.load(std::memory_order_relaxed);
+    while (live > peak
+           && ! g_peakBytes.compare_exchange_weak(
+               peak,
+               live,
+               std::memory_order_relaxed
+           )) {
+    }
+
+    if (s_histogramEnabled.load(std::memory_order_relaxed)) {
+        g_sizeClasses[getSizeClass(size)].fetch_add(
+            1,
+            std::memory_order_relaxed
+        );
+    }
+}
+
+} // namespace fri
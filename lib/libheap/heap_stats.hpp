@@ -0,0 +1,68 @@
+#ifndef HEAP_HEAP_STATS_HPP
+#define HEAP_HEAP_STATS_HPP
+
+#include "heap_switches.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace fri {
+
+// Size classes are powers of two from 8 bytes up, the last one takes every
+// larger allocation.
+constexpr int k_heapSizeClassCount = 24;
+
+struct HeapStatsSnapshot {
+    std::uint64_t allocations;
+    std::uint64_t frees;
+    std::uint64_t liveBytes;
+    std::uint64_t peakBytes;
+    // Allocations per size class, all zero unless the histogram is enabled
+    std::array<std::uint64_t, k_heapSizeClassCount> sizeClasses;
+};
+
+// Process-wide allocation counters, available in every build. They are off
+// until enabled by setEnabled() or by the environment variable
+// FRI_HEAP_STATS, which turns on the histogram as well if set to
+// "histogram".
+//
+// While both these and the HeapSampler are off, an allocation costs one
+// predictable branch on the HeapSwitches. While on, it costs a few relaxed
+// atomic additions. Either way every block carries the 16 byte BlockHeader,
+// which is what lets counting be toggled at any time. Only blocks allocated
+// while counting are counted when deleted, so the live bytes stay exact
+// across toggling.
+class HeapStats {
+public:
+    static void setEnabled(bool enabled);
+    static bool isEnabled();
+    static void setHistogramEnabled(bool enabled);
+    static bool isHistogramEnabled();
+
+    static HeapStatsSnapshot getSnapshot();
+    // Upper limit of the size class, zero for the last one.
+    static std::size_t getSizeClassLimit(int sizeClass);
+
+    // Called by operator new, returns whether the block was counted.
+    static bool recordAllocation(std::size_t size) {
+        if (! (details::HeapSwitches::get() & details::HeapSwitches::k_stats)) {
+            return false;
+        }
+        countAllocation(size);
+        return true;
+    }
+
+    // Called by operator delete for counted blocks only.
+    static void recordFree(std::size_t size);
+
+private:
+    static void countAllocation(std::size_t size);
+
+    static std::atomic<bool> s_histogramEnabled;
+};
+
+} // namespace fri
+
+#endif // HEAP_HEAP_STATS_HPP
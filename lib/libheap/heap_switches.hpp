@@ -0,0 +1,38 @@
+#ifndef HEAP_HEAP_SWITCHES_HPP
+#define HEAP_HEAP_SWITCHES_HPP
+
+#include <atomic>
+
+namespace fri {
+
+namespace details {
+
+// Instrumentation that is turned on. operator new reads all switches with a
+// single load, so while everything is off an allocation costs one
+// predictable branch.
+class HeapSwitches {
+public:
+    static constexpr unsigned k_sampler = 1u << 0;
+    static constexpr unsigned k_stats = 1u << 1;
+
+    static unsigned get() {
+        return s_switches.load(std::memory_order_relaxed);
+    }
+
+    static void set(unsigned switches, bool on) {
+        if (on) {
+            s_switches.fetch_or(switches, std::memory_order_relaxed);
+        } else {
+            s_switches.fetch_and(~switches, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    static inline std::atomic<unsigned> s_switches{0};
+};
+
+} // namespace details
+
+} // namespace fri
+
+#endif // HEAP_HEAP_SWITCHES_HPP
@@ -0,0 +1,108 @@
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "heap_monitor.hpp"
+
+#ifdef NDEBUG
+#error "The heap monitor is only built without NDEBUG"
+#endif
+
+// Allocates and deletes blocks from 16 threads, a part of them crossing over
+// to other threads through shared slots. Every thread leaks a known number of
+// blocks, which the monitor has to count exactly. Run twice, so the second
+// round adopts the shards of the first.
+namespace {
+
+constexpr int k_threadCount = 16;
+constexpr int k_rounds = 2;
+constexpr int k_iterations = 200000;
+constexpr int k_slotCount = 256;
+constexpr int k_leaksPerThread = 100;
+
+struct Block {
+    int owner;
+    int payload[3];
+};
+
+std::atomic<Block *> g_slots[k_slotCount];
+std::vector<Block *> g_leaks[k_threadCount];
+
+void churn(int index) {
+    std::mt19937 random(index);
+    std::vector<Block *> local;
+    for (int i = 0; i < k_iterations; ++i) {
+        const unsigned choice = random();
+        if (choice % 4 == 0) {
+            // Whatever was in the slot was most likely allocated elsewhere
+            Block *block = new Block {index, {i, i, i}};
+            delete g_slots[choice / 4 % k_slotCount].exchange(block);
+        } else if (choice % 4 == 1 || local.empty()) {
+            local.push_back(new Block {index, {i, i, i}});
+        } else {
+            delete local.back();
+            local.pop_back();
+        }
+    }
+    for (Block *block : local) {
+        delete block;
+    }
+
+    for (int i = 0; i < k_leaksPerThread; ++i) {
+        g_leaks[index].push_back(new Block {index, {i, i, i}});
+    }
+}
+
+} // namespace
+
+int main() {
+    fri::details::HeapMonitor &monitor
+        = fri::details::HeapMonitor::getInstance();
+    const size_t baseline = monitor.countLiveBlocks();
+    int failures = 0;
+
+    for (int round = 0; round < k_rounds; ++round) {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < k_threadCount; ++i) {
+            threads.emplace_back(churn, i);
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+
+        size_t slotted = 0;
+        for (std::atomic<Block *> &slot : g_slots) {
+            slotted += slot.load() != nullptr;
+        }
+        const size_t leaked = (round + 1) * k_threadCount * k_leaksPerThread;
+        const size_t expected = baseline + slotted + leaked;
+        const size_t live = monitor.countLiveBlocks();
+        std::printf(
+            "Round %d: %zu live blocks, expected %zu\n",
+            round + 1,
+            live,
+            expected
+        );
+        failures += live != expected;
+    }
+
+    for (std::atomic<Block *> &slot : g_slots) {
+        delete slot.exchange(nullptr);
+    }
+    for (std::vector<Block *> &leaks : g_leaks) {
+        for (Block *block : leaks) {
+            delete block;
+        }
+    }
+    const size_t live = monitor.countLiveBlocks();
+    std::printf(
+        "After cleanup: %zu live blocks, expected %zu\n",
+        live,
+        baseline
+    );
+    failures += live != baseline;
+
+    return failures == 0 ? 0 : 1;
+}
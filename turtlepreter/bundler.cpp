@@ -0,0 +1,36 @@
+#include "config.hpp"
+
+#include <libfriimgui/resource_bundle.hpp>
+
+#include <exception>
+#include <iostream>
+
+// Packs the images listed in the config into a resource bundle, so the
+// application can map them instead of decoding them on every start.
+// Usage: turtlepreter_bundler <config> <bundle>
+int main(int argc, char **argv)
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <config> <bundle>\n";
+        return 1;
+    }
+
+    try
+    {
+        const turtlepreter::Config config = turtlepreter::Config::loadFromFile(argv[1]);
+        std::vector<std::pair<std::string, std::filesystem::path>> images;
+        for (const auto &[name, path] : config.getImages())
+        {
+            images.emplace_back(path, path);
+        }
+        friimgui::ResourceBundle::write(argv[2], images);
+        std::cout << "Bundled " << images.size() << " images into " << argv[2] << "\n";
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
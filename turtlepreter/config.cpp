@@ -0,0 +1,106 @@
+#include "config.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace turtlepreter
+{
+
+    namespace
+    {
+        const int cDefaultWidth = 1024;
+        const int cDefaultHeight = 720;
+        const char *cDefaultImage = "turtlepreter/resources/turtle.png";
+        const std::string cImagePrefix = "image";
+    }
+
+    // --------------------------------------------------
+    // Config
+    // --------------------------------------------------
+    Config Config::loadFromFile(const std::filesystem::path &fileName)
+    {
+        Config config;
+        std::ifstream file(fileName);
+        if (!file)
+        {
+            return config;
+        }
+
+        try
+        {
+            const nlohmann::json json = nlohmann::json::parse(file);
+            config.m_width = json.value("width", config.m_width);
+            config.m_height = json.value("height", config.m_height);
+            config.m_vsync = json.value("vsync", config.m_vsync);
+            config.m_frameRateLimit = json.value("frameRateLimit", config.m_frameRateLimit);
+            config.m_provenance = json.value("provenance", config.m_provenance);
+            for (const auto &item : json.items())
+            {
+                if (item.key().rfind(cImagePrefix, 0) != 0 || !item.value().is_string())
+                {
+                    continue;
+                }
+
+                // The file is shared with Windows builds, which write backslashes
+                std::string path = item.value().get<std::string>();
+                std::replace(path.begin(), path.end(), '\\', '/');
+                config.m_images[item.key()] = path;
+            }
+        }
+        catch (const nlohmann::json::exception &)
+        {
+            throw std::runtime_error("Invalid config file: " + fileName.string());
+        }
+        return config;
+    }
+
+    Config::Config()
+        : m_width(cDefaultWidth),
+          m_height(cDefaultHeight),
+          m_vsync(true),
+          m_frameRateLimit(0),
+          m_provenance(false),
+          m_images()
+    {
+    }
+
+    int Config::getWidth() const
+    {
+        return m_width;
+    }
+
+    int Config::getHeight() const
+    {
+        return m_height;
+    }
+
+    bool Config::isVsyncEnabled() const
+    {
+        return m_vsync;
+    }
+
+    double Config::getFrameRateLimit() const
+    {
+        return m_frameRateLimit;
+    }
+
+    bool Config::isProvenanceEnabled() const
+    {
+        return m_provenance;
+    }
+
+    std::string Config::getImage(const std::string &name) const
+    {
+        const auto it = m_images.find(name);
+        return it != m_images.end() ? it->second : cDefaultImage;
+    }
+
+    const std::map<std::string, std::string> &Config::getImages() const
+    {
+        return m_images;
+    }
+
+} // namespace turtlepreter
@@ -0,0 +1,49 @@
+#ifndef TURTLEPRETER_CONFIG_HPP
+#define TURTLEPRETER_CONFIG_HPP
+
+#include <filesystem>
+#include <map>
+#include <string>
+
+namespace turtlepreter
+{
+
+    // --------------------------------------------------
+    // Config
+    // --------------------------------------------------
+    // Settings read from resources/config.json: the window size, frame
+    // pacing and the images of the actors. Every key starting with "image"
+    // names an image, its path is relative to the working directory. Missing
+    // settings keep their defaults.
+    class Config
+    {
+    public:
+        static Config loadFromFile(const std::filesystem::path &fileName);
+
+        Config();
+
+        int getWidth() const;
+        int getHeight() const;
+        bool isVsyncEnabled() const;
+        // Zero means unlimited.
+        double getFrameRateLimit() const;
+        // Recording which node drew every segment, off by default as it
+        // keeps four bytes per segment in memory.
+        bool isProvenanceEnabled() const;
+
+        // Falls back to the default turtle image for unknown names.
+        std::string getImage(const std::string &name) const;
+        const std::map<std::string, std::string> &getImages() const;
+
+    private:
+        int m_width;
+        int m_height;
+        bool m_vsync;
+        double m_frameRateLimit;
+        bool m_provenance;
+        std::map<std::string, std::string> m_images;
+    };
+
+} // namespace turtlepreter
+
+#endif
@@ -4,6 +4,7 @@ namespace turtlepreter
 {
     Controllable::Controllable(const std::string &imgPath)
         : m_transformation(),
+          m_imgPath(imgPath),
           m_image(friimgui::Image::createImage(imgPath))
     {
     }
@@ -27,9 +28,29 @@ namespace turtlepreter
         m_transformation.rotation.resetValue();
     }
 
+    void Controllable::setProvenance(std::uint32_t provenance)
+    {
+        (void)provenance;
+    }
+
+    std::size_t Controllable::getOutputSize() const
+    {
+        return 0;
+    }
+
     friimgui::Transformation &Controllable::getTransformation()
     {
         return m_transformation;
     }
 
+    const friimgui::Transformation &Controllable::getTransformation() const
+    {
+        return m_transformation;
+    }
+
+    const std::string &Controllable::getImagePath() const
+    {
+        return m_imgPath;
+    }
+
 }
@@ -7,6 +7,8 @@
 #include "libfriimgui/image.hpp"
 
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 namespace turtlepreter
@@ -22,12 +24,21 @@ namespace turtlepreter
         virtual void draw(const friimgui::Region &region);
         virtual void reset();
 
+        // Tags everything produced from now on with the id of its origin
+        virtual void setProvenance(std::uint32_t provenance);
+        // Size of what the commands produced so far, e.g. path segments,
+        // for the profiler to attribute growth to nodes
+        virtual std::size_t getOutputSize() const;
+
         friimgui::Transformation &getTransformation();
+        const friimgui::Transformation &getTransformation() const;
+        const std::string &getImagePath() const;
 
     protected:
         friimgui::Transformation m_transformation;
 
     private:
+        std::string m_imgPath;
         friimgui::Image m_image;
         ImVec2 m_initialTranslation;
     };
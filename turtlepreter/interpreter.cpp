@@ -2,14 +2,32 @@
 #include "perk.hpp"
 #include "turtle.hpp"
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
 #include <iostream>
 #include <stdexcept>
+#include <utility>
 
 #include "heap_monitor.hpp"
 
 namespace turtlepreter
 {
 
+    void appendLabelNumber(std::string &label, int value)
+    {
+        char buffer[16];
+        const std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        label.append(buffer, result.ptr);
+    }
+
+    void appendLabelNumber(std::string &label, float value)
+    {
+        char buffer[64];
+        const std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, 6);
+        label.append(buffer, result.ec == std::errc() ? result.ptr : buffer);
+    }
+
     // --------------------------------------------------
     // Node
     // --------------------------------------------------
@@ -34,6 +52,7 @@ namespace turtlepreter
     Node::Node(ICommand *command, Cursor *cursor)
         : m_parent(nullptr),
           m_subnodes(),
+          m_index(k_unindexed),
           m_command(command),
           m_cursor(cursor)
     {
@@ -78,38 +97,77 @@ namespace turtlepreter
         return m_cursor;
     }
 
+    const Cursor *Node::getCursor() const
+    {
+        return m_cursor;
+    }
+
+    std::uint32_t Node::getIndex() const
+    {
+        return m_index;
+    }
+
+    void Node::setIndex(std::uint32_t index)
+    {
+        m_index = index;
+    }
+
     std::string Node::toString() const
     {
         std::string result;
+        appendLabel(result);
+        return result;
+    }
 
+    void Node::appendLabel(std::string &label) const
+    {
         if (m_command != nullptr)
         {
-            result = "Command: " + m_command->toString();
+            label += "Command: ";
+            m_command->appendLabel(label);
         }
         else
         {
-            result = "No command";
+            label += "No command";
         }
         if (m_cursor != nullptr)
         {
-            result += " " + m_cursor->toString();
+            label += ' ';
+            m_cursor->appendLabel(label);
         }
-        return result;
     }
 
     // --------------------------------------------------
     // Cursor
     // --------------------------------------------------
     Cursor::Cursor()
-        : m_node(nullptr)
+        : m_node(nullptr),
+          m_version(0)
     {
     }
 
+    std::string Cursor::toString() const
+    {
+        std::string result;
+        appendLabel(result);
+        return result;
+    }
+
     void Cursor::setNode(Node *node)
     {
         m_node = node;
     }
 
+    std::uint32_t Cursor::getVersion() const
+    {
+        return m_version;
+    }
+
+    void Cursor::changed()
+    {
+        ++m_version;
+    }
+
     // --------------------------------------------------
     // CursorUp
     // --------------------------------------------------
@@ -122,9 +180,9 @@ namespace turtlepreter
     {
     }
 
-    std::string CursorUp::toString()
+    void CursorUp::appendLabel(std::string &label) const
     {
-        return "Cursor: Up";
+        label += "Cursor: Up";
     }
 
     // --------------------------------------------------
@@ -153,23 +211,30 @@ namespace turtlepreter
         m_currentIndex = 0;
     }
 
-    std::string SequentialCursor::toString()
+    void SequentialCursor::appendLabel(std::string &label) const
     {
-        std::size_t size = m_node->getSubnodes().size();
-        const std::vector<Node *> &sons = m_node->getSubnodes();
+        label += "Cursor: Up";
+    }
 
-        /*
-        if (static_cast<std::size_t>(m_currentIndex) == sons.size())
+    // --------------------------------------------------
+    // NodeProfile
+    // --------------------------------------------------
+    double NodeProfile::getEstimatedSeconds() const
+    {
+        if (timedExecutions == 0)
         {
-            return "Cursor: Up";
+            return 0;
         }
-        else
+        return timedNanoseconds * 1e-9 * executions / timedExecutions;
+    }
+
+    double NodeProfile::getEstimatedOutputGrowth() const
+    {
+        if (timedExecutions == 0)
         {
-            return "Son " + std::to_string(m_currentIndex + 1) + "/" + std::to_string(size);
+            return 0;
         }
-        */
-
-        return "Cursor: Up";
+        return static_cast<double>(timedOutputGrowth) * executions / timedExecutions;
     }
 
     // --------------------------------------------------
@@ -178,19 +243,51 @@ namespace turtlepreter
     Interpreter::Interpreter(Node *root)
         : m_root(root),
           m_current(root),
-          m_exeCount(0)
+          m_exeCount(0),
+          m_nodes(),
+          m_labels(),
+          m_treeBytes(0),
+          m_stateListener(),
+          m_profiling(false),
+          m_profiles(),
+          m_maxTimedNanoseconds(0),
+          m_timingCountdown(1),
+          m_random()
     {
+        if (m_root != nullptr)
+        {
+            indexSubtreeNodes(m_root);
+        }
+        m_labels.resize(m_nodes.size());
     }
 
     void Interpreter::interpretAll(Controllable &controllable)
     {
         while (m_current != nullptr)
         {
-            interpretStep(controllable);
+            executeStep(controllable);
         }
+        notifyStateListener();
     }
 
     void Interpreter::interpretStep(Controllable &controllable)
+    {
+        executeStep(controllable);
+        notifyStateListener();
+    }
+
+    int Interpreter::interpretSteps(Controllable &controllable, int stepCount)
+    {
+        const int exeCount = m_exeCount;
+        for (int i = 0; i < stepCount && m_current != nullptr; ++i)
+        {
+            executeStep(controllable);
+        }
+        notifyStateListener();
+        return m_exeCount - exeCount;
+    }
+
+    void Interpreter::executeStep(Controllable &controllable)
     {
         if (m_current == nullptr)
         {
@@ -207,25 +304,244 @@ namespace turtlepreter
             return;
         }
 
+        if (m_current->getIndex() == Node::k_unindexed)
+        {
+            indexNewNodes();
+        }
+
         if (ICommand *command = m_current->getCommand())
         {
-            command->executeSafely(controllable);
+            controllable.setProvenance(m_current->getIndex());
+            if (m_profiling)
+            {
+                executeProfiled(*command, controllable);
+            }
+            else
+            {
+                command->executeSafely(controllable);
+            }
             ++m_exeCount;
         }
 
         m_current = m_current->getCursor()->next();
     }
 
+    void Interpreter::executeProfiled(ICommand &command, Controllable &controllable)
+    {
+        NodeProfile &profile = m_profiles[m_current->getIndex()];
+        ++profile.executions;
+
+        // Reading the clock and the output size costs about as much as a
+        // simple command, so only one in k_timingInterval executions is
+        // measured on average. The others only count.
+        if (--m_timingCountdown == 0)
+        {
+            executeTimed(command, controllable, profile);
+            return;
+        }
+
+        // Failures are counted instead of printed, printing would dominate
+        if (command.canBeExecuted(controllable))
+        {
+            command.execute(controllable);
+        }
+        else
+        {
+            ++profile.failures;
+        }
+    }
+
+    void Interpreter::executeTimed(ICommand &command, Controllable &controllable, NodeProfile &profile)
+    {
+        m_timingCountdown = 1 + m_random() % (2 * k_timingInterval - 1);
+        const std::size_t outputSize = controllable.getOutputSize();
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        const bool executable = command.canBeExecuted(controllable);
+        if (executable)
+        {
+            command.execute(controllable);
+        }
+
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        profile.timedNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+        ++profile.timedExecutions;
+        m_maxTimedNanoseconds = std::max(m_maxTimedNanoseconds, profile.timedNanoseconds);
+
+        if (!executable)
+        {
+            ++profile.failures;
+        }
+        const std::size_t grownSize = controllable.getOutputSize();
+        if (grownSize > outputSize)
+        {
+            profile.timedOutputGrowth += grownSize - outputSize;
+        }
+    }
+
     Node *Interpreter::getRoot() const
     {
         return m_root;
     }
 
+    Node *Interpreter::getCurrent() const
+    {
+        return m_current;
+    }
+
+    Node *Interpreter::getNode(std::uint32_t index) const
+    {
+        if (index < m_nodes.size())
+        {
+            return m_nodes[index];
+        }
+        return nullptr;
+    }
+
+    const std::string &Interpreter::getLabel(const Node *node)
+    {
+        if (node->getIndex() == Node::k_unindexed)
+        {
+            indexNewNodes();
+        }
+
+        Label &label = m_labels[node->getIndex()];
+        const std::uint32_t cursorVersion = node->getCursor()->getVersion();
+        if (!label.valid || label.cursorVersion != cursorVersion)
+        {
+            // The string keeps its capacity, so formatting again rarely allocates
+            label.text.clear();
+            node->appendLabel(label.text);
+            label.cursorVersion = cursorVersion;
+            label.valid = true;
+        }
+        return label.text;
+    }
+
+    std::size_t Interpreter::getNodeCount() const
+    {
+        return m_nodes.size();
+    }
+
+    std::size_t Interpreter::getTreeBytes() const
+    {
+        return m_treeBytes + m_nodes.capacity() * sizeof(Node *);
+    }
+
     void Interpreter::reset()
     {
         m_current = m_root;
         resetSubtreeNodes(m_root);
         m_exeCount = 0;
+
+        // Subnodes may have been added since the last indexing
+        m_nodes.clear();
+        m_treeBytes = 0;
+        indexSubtreeNodes(m_root);
+        m_labels.clear();
+        m_labels.resize(m_nodes.size());
+        if (m_profiling)
+        {
+            clearProfiles();
+        }
+        notifyStateListener();
+    }
+
+    void Interpreter::setStateListener(std::function<void()> listener)
+    {
+        m_stateListener = std::move(listener);
+    }
+
+    void Interpreter::setProfiling(bool profiling)
+    {
+        if (profiling && !m_profiling)
+        {
+            m_profiling = true;
+            clearProfiles();
+        }
+        else if (!profiling)
+        {
+            m_profiling = false;
+            m_profiles.clear();
+            m_profiles.shrink_to_fit();
+            m_maxTimedNanoseconds = 0;
+        }
+    }
+
+    bool Interpreter::isProfiling() const
+    {
+        return m_profiling;
+    }
+
+    void Interpreter::clearProfiles()
+    {
+        if (!m_profiling)
+        {
+            return;
+        }
+        m_profiles.assign(m_nodes.size(), NodeProfile());
+        m_maxTimedNanoseconds = 0;
+    }
+
+    const std::vector<NodeProfile> &Interpreter::getProfiles() const
+    {
+        return m_profiles;
+    }
+
+    std::uint64_t Interpreter::getMaxTimedNanoseconds() const
+    {
+        return m_maxTimedNanoseconds;
+    }
+
+    void Interpreter::notifyStateListener()
+    {
+        if (m_stateListener)
+        {
+            m_stateListener();
+        }
+    }
+
+    void Interpreter::indexSubtreeNodes(Node *node)
+    {
+        node->setIndex(static_cast<std::uint32_t>(m_nodes.size()));
+        m_nodes.push_back(node);
+        // Commands are owned by the caller, cursors counted at the larger size
+        m_treeBytes += sizeof(Node) + sizeof(SequentialCursor) + node->getSubnodes().capacity() * sizeof(Node *);
+
+        for (Node *subnode : node->getSubnodes())
+        {
+            indexSubtreeNodes(subnode);
+        }
+    }
+
+    void Interpreter::indexNewNodes()
+    {
+        if (m_root == nullptr)
+        {
+            return;
+        }
+        indexNewSubtreeNodes(m_root);
+        m_labels.resize(m_nodes.size());
+        if (m_profiling)
+        {
+            m_profiles.resize(m_nodes.size(), NodeProfile());
+        }
+    }
+
+    void Interpreter::indexNewSubtreeNodes(Node *node)
+    {
+        // Parents still come before their subnodes
+        if (node->getIndex() == Node::k_unindexed)
+        {
+            node->setIndex(static_cast<std::uint32_t>(m_nodes.size()));
+            m_nodes.push_back(node);
+            m_treeBytes += sizeof(Node) + sizeof(SequentialCursor) + node->getSubnodes().capacity() * sizeof(Node *);
+        }
+
+        for (Node *subnode : node->getSubnodes())
+        {
+            indexNewSubtreeNodes(subnode);
+        }
     }
 
     void Interpreter::interpterSubtreeNodes(Node *node, Controllable &controllable)
@@ -264,6 +580,13 @@ namespace turtlepreter
     // --------------------------------------------------
     // ICommand
     // --------------------------------------------------
+    std::string ICommand::toString() const
+    {
+        std::string result;
+        appendLabel(result);
+        return result;
+    }
+
     bool ICommand::canBeExecuted(Controllable &c)
     {
         return true;
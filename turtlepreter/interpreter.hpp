@@ -3,6 +3,9 @@
 
 #include "controllable.hpp"
 
+#include <cstdint>
+#include <functional>
+#include <random>
 #include <string>
 #include <vector>
 
@@ -12,6 +15,11 @@ namespace turtlepreter
     class Cursor;
     class ICommand;
 
+    // Append numbers to labels without temporary strings, floats with six
+    // decimals like std::to_string
+    void appendLabelNumber(std::string &label, int value);
+    void appendLabelNumber(std::string &label, float value);
+
     // --------------------------------------------------
     // Node
     // --------------------------------------------------
@@ -21,21 +29,30 @@ namespace turtlepreter
         static Node *createLeafNode(ICommand *command);
         static Node *createSequentialNode();
 
+        // Index of a node not yet indexed by the interpreter
+        static constexpr std::uint32_t k_unindexed = UINT32_MAX;
+
     public:
         ~Node();
 
         std::string toString() const;
+        void appendLabel(std::string &label) const;
 
         void addSubnode(Node *subnode);
 
         Node *getParent() const;
         const std::vector<Node *> &getSubnodes() const;
         Cursor *getCursor();
+        const Cursor *getCursor() const;
         ICommand *getCommand() const;
 
+        std::uint32_t getIndex() const;
+        void setIndex(std::uint32_t index);
+
     private:
         Node *m_parent;
         std::vector<Node *> m_subnodes;
+        std::uint32_t m_index;
 
         ICommand *m_command;
         Cursor *m_cursor;
@@ -52,7 +69,9 @@ namespace turtlepreter
         virtual ~ICommand() = default;
 
         virtual void execute(Controllable &c) = 0;
-        virtual std::string toString() = 0;
+        // Commands do not change once created, nor do their labels
+        virtual void appendLabel(std::string &label) const = 0;
+        std::string toString() const;
 
         virtual bool canBeExecuted(Controllable &c);
 
@@ -64,6 +83,26 @@ namespace turtlepreter
 
     
 
+    // --------------------------------------------------
+    // NodeProfile
+    // --------------------------------------------------
+    // What the executions of one node cost while profiling. Only every few
+    // executions are timed and measured, the estimates scale their time and
+    // output to all of them.
+    struct NodeProfile
+    {
+        std::uint64_t executions;
+        std::uint64_t failures;
+        std::uint64_t timedExecutions;
+        std::uint64_t timedNanoseconds;
+        // Output of the controllable added by the timed executions, e.g.
+        // path segments
+        std::uint64_t timedOutputGrowth;
+
+        double getEstimatedSeconds() const;
+        double getEstimatedOutputGrowth() const;
+    };
+
     // --------------------------------------------------
     // Interpreter
     // --------------------------------------------------
@@ -76,18 +115,78 @@ namespace turtlepreter
 
         void interpretStep(Controllable &controllable);
 
+        // Executes up to the given number of steps, notifying the listener
+        // once. Returns the number of commands executed.
+        int interpretSteps(Controllable &controllable, int stepCount);
+
         void reset();
 
         Node *getRoot() const;
+        // The node to be executed next, null once finished
+        Node *getCurrent() const;
+        Node *getNode(std::uint32_t index) const;
+        // Formatted on first use and again only after the cursor of the node
+        // changed its state, valid until the nodes are indexed again. Nodes
+        // added since the last indexing are indexed first.
+        const std::string &getLabel(const Node *node);
+        std::size_t getNodeCount() const;
+        // Estimated heap size of the nodes, their cursors and the index,
+        // updated whenever the nodes are indexed
+        std::size_t getTreeBytes() const;
 
         bool wasSomethingExecuted();
         bool isFinished();
 
+        // Called after every change of the interpretation state, once per
+        // interpretAll() call, e.g. to wake up a window waiting for events.
+        void setStateListener(std::function<void()> listener);
+
+        // Profiles are collected from now on and cleared by reset(), so they
+        // describe the run since then
+        void setProfiling(bool profiling);
+        bool isProfiling() const;
+        void clearProfiles();
+        // Indexed by Node::getIndex(), empty unless profiling
+        const std::vector<NodeProfile> &getProfiles() const;
+        // Largest timed nanoseconds of a single node, to scale a heatmap
+        std::uint64_t getMaxTimedNanoseconds() const;
+
     private:
+        struct Label
+        {
+            std::string text;
+            std::uint32_t cursorVersion;
+            bool valid;
+        };
+
         Node *m_root;
         Node *m_current;
         int m_exeCount;
-
+        std::vector<Node *> m_nodes;
+        std::vector<Label> m_labels;
+        std::size_t m_treeBytes;
+        std::function<void()> m_stateListener;
+
+        static constexpr std::uint32_t k_timingInterval = 64;
+
+        bool m_profiling;
+        std::vector<NodeProfile> m_profiles;
+        std::uint64_t m_maxTimedNanoseconds;
+        // Executions left until the next timed one, drawn at random so
+        // loops in step with the interval are still timed fairly
+        std::uint32_t m_timingCountdown;
+        std::minstd_rand m_random;
+
+        void executeStep(Controllable &controllable);
+        void executeProfiled(ICommand &command, Controllable &controllable);
+        void executeTimed(ICommand &command, Controllable &controllable, NodeProfile &profile);
+        void notifyStateListener();
+
+        void indexSubtreeNodes(Node *node);
+        // Appends the nodes added since the last indexing, the others keep
+        // their indices, labels and profiles
+        void indexNewNodes();
+        void indexNewSubtreeNodes(Node *node);
         void resetSubtreeNodes(Node *node);
         void interpterSubtreeNodes(Node *node, Controllable &controllable);
     };
@@ -104,11 +203,20 @@ namespace turtlepreter
         virtual Node *next() = 0;
         virtual void reset() = 0;
 
-        virtual std::string toString() = 0;
+        virtual void appendLabel(std::string &label) const = 0;
+        std::string toString() const;
         void setNode(Node *node);
 
+        // Changes whenever the state shown by the label changes
+        std::uint32_t getVersion() const;
+
     protected:
+        void changed();
+
         Node *m_node;
+
+    private:
+        std::uint32_t m_version;
     };
 
     // --------------------------------------------------
@@ -119,7 +227,7 @@ namespace turtlepreter
     public:
         Node *next() override;
         void reset() override;
-        std::string toString() override;
+        void appendLabel(std::string &label) const override;
     };
 
     // --------------------------------------------------
@@ -132,9 +240,10 @@ namespace turtlepreter
 
         Node *next() override;
         void reset() override;
-        std::string toString() override;
+        void appendLabel(std::string &label) const override;
 
     private:
+        // Not part of the label, so stepping leaves the version alone
         int m_currentIndex;
     };
 
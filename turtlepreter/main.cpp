@@ -1,24 +1,63 @@
+#include "config.hpp"
 #include "interpreter.hpp"
 #include "turtle.hpp"
 #include "turtle_gui.hpp"
 
+#include <libfriimgui/frame_profiler.hpp>
+#include <libfriimgui/texture_cache.hpp>
 #include <libfriimgui/window.hpp>
 
 #include <imgui/imgui.h>
 
+#include <cstdlib>
 #include <iostream>
+#include <string>
 
 #include "heap_monitor.hpp"
 
-int main() {
+int main(int argc, char **argv) {
     namespace tp = turtlepreter;
 
     const int cCenterX = 320;
     const int cCenterY = 320;
 
-    friimgui::Window *window = friimgui::Window::initializeWindow(1024, 720);
+    // --headless <frames> runs the given number of frames without a display,
+    // --dump <file> saves the last frame as a PNG file
+    int headlessFrames = 0;
+    std::string dumpFileName;
+    for (int i = 1; i < argc; i += 2) {
+        const std::string option = argv[i];
+        if (i + 1 < argc && option == "--headless") {
+            headlessFrames = std::atoi(argv[i + 1]);
+        } else if (i + 1 < argc && option == "--dump") {
+            dumpFileName = argv[i + 1];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--headless <frames>] [--dump <file>]" << std::endl;
+            return 1;
+        }
+    }
+
+    const tp::Config config = tp::Config::loadFromFile("turtlepreter/resources/config.json");
+    if (!friimgui::TextureCache::getInstance().mountBundle("turtlepreter/resources/resources.bundle")) {
+        std::cout << "Resource bundle not found, images will be decoded" << std::endl;
+    }
+
+    friimgui::Window *window = headlessFrames > 0
+                                   ? friimgui::Window::initializeHeadless(config.getWidth(), config.getHeight())
+                                   : friimgui::Window::initializeWindow(config.getWidth(), config.getHeight());
+    if (window == nullptr) {
+        return 1;
+    }
+    window->setVsync(config.isVsyncEnabled());
+    window->setFrameRateLimit(config.getFrameRateLimit());
+    window->setFrameCount(headlessFrames);
+    if (!dumpFileName.empty()) {
+        window->setFramebufferDump(dumpFileName);
+    }
 
-    tp::Turtle turtle("turtlepreter/resources/turtle.png", cCenterX, cCenterY);
+    tp::Turtle turtle(config.getImage("imageTurtle"), cCenterX, cCenterY);
+    turtle.setProvenanceEnabled(config.isProvenanceEnabled());
+    turtle.setPathResidentLimit(size_t(256) << 20);
 
     tp::CommandJump cmdJump1(cCenterX, cCenterY - 100);
     tp::CommandSetColor cmdColor(ImColor(255, 0, 0));
@@ -46,12 +85,21 @@ int main() {
     nodeRoot->addSubnode(nodeRotate);
 
     tp::Interpreter interpreter(nodeRoot);
+    interpreter.setStateListener(&friimgui::Window::requestRedraw);
     tp::TurtleGUI turtleGUI(&turtle, &interpreter);
 
     window->setGUI(&turtleGUI);
     window->run();
     friimgui::Window::releaseWindow();
 
+    if (headlessFrames > 0) {
+        const auto samples = friimgui::FrameProfiler::getInstance().getSamples();
+        const auto build = friimgui::FrameProfiler::calculatePercentiles(samples, friimgui::FramePhase::Build);
+        const auto busy = friimgui::FrameProfiler::calculateBusyPercentiles(samples);
+        std::cout << samples.size() << " frames, build p50/p95/p99 [us]: " << build.p50 << " / " << build.p95 << " / "
+                  << build.p99 << ", busy: " << busy.p50 << " / " << busy.p95 << " / " << busy.p99 << std::endl;
+    }
+
     if (turtle.getPathSegmentCount() ) {
         (void)turtle.getPathSegmentPoints(0);
         (void)turtle.getPathSegmentColor(0);
@@ -0,0 +1,242 @@
+#include "memory_panel.hpp"
+#include "turtle.hpp"
+
+#include <libfriimgui/texture_cache.hpp>
+
+#include <imgui/imgui.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <iterator>
+#include <utility>
+
+namespace turtlepreter
+{
+
+    namespace
+    {
+        const char *const cUnits[] = {"B", "KiB", "MiB", "GiB"};
+
+        // Scales the bytes down to the largest unit below them
+        const char *scaleBytes(double &bytes)
+        {
+            std::size_t unit = 0;
+            while (bytes >= 1024 && unit + 1 < std::size(cUnits))
+            {
+                bytes /= 1024;
+                ++unit;
+            }
+            return cUnits[unit];
+        }
+
+        void textBytes(const char *label, double bytes)
+        {
+            const char *unit = scaleBytes(bytes);
+            ImGui::Text("%s: %.1f %s", label, bytes, unit);
+        }
+
+        void cellBytes(double bytes)
+        {
+            const char *unit = scaleBytes(bytes);
+            ImGui::Text("%.1f %s", bytes, unit);
+        }
+    }
+
+    MemoryPanel::MemoryPanel(Controllable *controllable, Interpreter *interpreter)
+        : m_controllable(controllable),
+          m_interpreter(interpreter),
+          m_visible(false),
+          m_snapshot(),
+          m_collectMicros(0),
+          m_frameAllocations(0),
+          m_lastSample(),
+          m_lastAllocations(0),
+          m_allocationRate(0),
+          m_history(),
+          m_historyCount(0),
+          m_historyNext(0),
+          m_sites(),
+          m_siteCount(0)
+    {
+    }
+
+    void MemoryPanel::setVisible(bool visible)
+    {
+        m_visible = visible;
+        if (visible)
+        {
+            fri::HeapStats::setEnabled(true);
+            fri::details::HeapSampler &sampler = fri::details::HeapSampler::getInstance();
+            if (sampler.getSampleRate() == 0)
+            {
+                sampler.setSampleRate(k_sampleRate);
+            }
+        }
+    }
+
+    bool MemoryPanel::isVisible() const
+    {
+        return m_visible;
+    }
+
+    void MemoryPanel::build()
+    {
+        if (!m_visible)
+        {
+            return;
+        }
+
+        update();
+
+        ImGui::SetNextWindowSize(ImVec2(420, 0), ImGuiCond_FirstUseEver);
+        if (!ImGui::Begin("Memory", &m_visible))
+        {
+            ImGui::End();
+            return;
+        }
+
+        buildHeap();
+        buildSubsystems();
+        buildSites();
+
+        ImGui::End();
+    }
+
+    void MemoryPanel::update()
+    {
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        const std::uint64_t previousAllocations = m_snapshot.allocations;
+        m_snapshot = fri::HeapStats::getSnapshot();
+        m_frameAllocations = m_snapshot.allocations - previousAllocations;
+        updateSites();
+        m_collectMicros = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - now).count();
+
+        if (m_historyCount == 0 || now - m_lastSample >= k_sampleInterval)
+        {
+            if (m_historyCount > 0)
+            {
+                const double seconds = std::chrono::duration<double>(now - m_lastSample).count();
+                m_allocationRate = (m_snapshot.allocations - m_lastAllocations) / seconds;
+            }
+            m_lastSample = now;
+            m_lastAllocations = m_snapshot.allocations;
+
+            m_history[m_historyNext] = static_cast<float>(m_snapshot.liveBytes / (1024.0 * 1024.0));
+            m_historyNext = (m_historyNext + 1) % k_historyLength;
+            m_historyCount = std::min(m_historyCount + 1, k_historyLength);
+        }
+    }
+
+    void MemoryPanel::updateSites()
+    {
+        namespace fd = fri::details;
+        fd::HeapSampler &sampler = fd::HeapSampler::getInstance();
+        fd::HeapStackSummary stacks[k_siteCount];
+        const std::size_t count = sampler.getTopStacks(stacks, k_siteCount);
+
+        // Names move along with their stacks, so only a stack new to the
+        // top ones allocates its name
+        std::array<Site, k_siteCount> previous = std::move(m_sites);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            Site &site = m_sites[i];
+            std::size_t kept = 0;
+            while (kept < m_siteCount && previous[kept].stack.stack != stacks[i].stack)
+            {
+                ++kept;
+            }
+            if (kept < m_siteCount)
+            {
+                site.name = std::move(previous[kept].name);
+            }
+            else
+            {
+                site.name = sampler.describeCaller(stacks[i].stack);
+            }
+            site.stack = stacks[i];
+        }
+        m_siteCount = count;
+    }
+
+    void MemoryPanel::buildHeap()
+    {
+        textBytes("Live", static_cast<double>(m_snapshot.liveBytes));
+        ImGui::SameLine(200);
+        textBytes("Peak", static_cast<double>(m_snapshot.peakBytes));
+        ImGui::Text("Allocations: %llu, frees: %llu",
+                    static_cast<unsigned long long>(m_snapshot.allocations),
+                    static_cast<unsigned long long>(m_snapshot.frees));
+        ImGui::Text("Rate: %.0f allocations/s, %llu in the last frame",
+                    m_allocationRate,
+                    static_cast<unsigned long long>(m_frameAllocations));
+
+        // The ring is plotted from its oldest sample on
+        const std::size_t oldest = m_historyCount < k_historyLength ? 0 : m_historyNext;
+        ImGui::PlotLines(
+            "##live",
+            m_history.data(),
+            static_cast<int>(m_historyCount),
+            static_cast<int>(oldest),
+            "Live [MiB]",
+            0,
+            FLT_MAX,
+            ImVec2(-1, 80));
+        ImGui::TextDisabled("Collected in %.1f us", m_collectMicros);
+    }
+
+    void MemoryPanel::buildSubsystems()
+    {
+        if (!ImGui::CollapsingHeader("Subsystems", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            return;
+        }
+
+        const friimgui::TextureCacheStats textures = friimgui::TextureCache::getInstance().getStats();
+        textBytes("Program tree", static_cast<double>(m_interpreter->getTreeBytes()));
+        if (const Turtle *turtle = dynamic_cast<const Turtle *>(m_controllable))
+        {
+            textBytes("Path storage", static_cast<double>(turtle->getPathMemoryBytes()));
+            ImGui::SameLine(200);
+            textBytes("spilled", static_cast<double>(turtle->getPath().getSpilledBytes()));
+        }
+        textBytes("Texture pixels", static_cast<double>(textures.pixelBytes));
+        ImGui::SameLine(200);
+        textBytes("atlas", static_cast<double>(textures.residentBytes));
+    }
+
+    void MemoryPanel::buildSites()
+    {
+        if (!ImGui::CollapsingHeader("Top allocation sites", ImGuiTreeNodeFlags_DefaultOpen))
+        {
+            return;
+        }
+
+        // The sampled totals stand for about rate times as many allocations
+        const double rate = fri::details::HeapSampler::getInstance().getSampleRate();
+        if (ImGui::BeginTable("##sites", 4, ImGuiTableFlags_Borders))
+        {
+            ImGui::TableSetupColumn("Site");
+            ImGui::TableSetupColumn("Count");
+            ImGui::TableSetupColumn("Bytes");
+            ImGui::TableSetupColumn("Live");
+            ImGui::TableHeadersRow();
+
+            for (std::size_t i = 0; i < m_siteCount; ++i)
+            {
+                const Site &site = m_sites[i];
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(site.name.c_str());
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%.0f", site.stack.count * rate);
+                ImGui::TableSetColumnIndex(2);
+                cellBytes(site.stack.bytes * rate);
+                ImGui::TableSetColumnIndex(3);
+                cellBytes(site.stack.liveBytes * rate);
+            }
+            ImGui::EndTable();
+        }
+        ImGui::TextDisabled("Estimated from one in %.0f allocations", rate);
+    }
+
+} // namespace turtlepreter
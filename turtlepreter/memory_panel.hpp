@@ -0,0 +1,85 @@
+#ifndef TURTLEPRETER_MEMORY_PANEL_HPP
+#define TURTLEPRETER_MEMORY_PANEL_HPP
+
+#include "controllable.hpp"
+#include "interpreter.hpp"
+
+#include "heap_sampler.hpp"
+#include "heap_stats.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace turtlepreter
+{
+
+    // --------------------------------------------------
+    // MemoryPanel
+    // --------------------------------------------------
+    // Window with the live heap of the process, read from the libheap
+    // counters, and the memory held by the program tree, the path and the
+    // textures. Opening it turns the heap counters on, and the heap sampler
+    // at k_sampleRate unless it already runs, so only blocks allocated since
+    // then are counted.
+    //
+    // Every frame reads a snapshot of the counters, the top stacks ranked by
+    // the sampler and a few sizes, without allocating. Only a stack new to
+    // the top ones has its name resolved. The graph takes a sample every
+    // k_sampleInterval.
+    class MemoryPanel
+    {
+    public:
+        MemoryPanel(Controllable *controllable, Interpreter *interpreter);
+
+        void setVisible(bool visible);
+        bool isVisible() const;
+
+        // Draws the window if visible, to be called inside a frame.
+        void build();
+
+    private:
+        struct Site
+        {
+            fri::details::HeapStackSummary stack;
+            std::string name;
+        };
+
+        static constexpr std::size_t k_historyLength = 240;
+        static constexpr std::chrono::milliseconds k_sampleInterval{250};
+        static constexpr std::size_t k_siteCount = 8;
+        static constexpr unsigned k_sampleRate = 1024;
+
+        void update();
+        void updateSites();
+        void buildHeap();
+        void buildSubsystems();
+        void buildSites();
+
+        Controllable *m_controllable;
+        Interpreter *m_interpreter;
+        bool m_visible;
+
+        fri::HeapStatsSnapshot m_snapshot;
+        // Time to collect everything the frame shows
+        float m_collectMicros;
+        // Made since the previous frame, zero for a GUI at rest
+        std::uint64_t m_frameAllocations;
+
+        std::chrono::steady_clock::time_point m_lastSample;
+        std::uint64_t m_lastAllocations;
+        double m_allocationRate;
+        std::array<float, k_historyLength> m_history;
+        std::size_t m_historyCount;
+        std::size_t m_historyNext;
+
+        std::array<Site, k_siteCount> m_sites;
+        std::size_t m_siteCount;
+    };
+
+} // namespace turtlepreter
+
+#endif
@@ -0,0 +1,273 @@
+#include "path_codec.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace turtlepreter
+{
+
+    namespace
+    {
+        // Keeps every delta of two quantized coordinates within 30 bits, so
+        // the zigzag value with the jump flag still fits a 32-bit varint
+        const float cCoordinateLimit = static_cast<float>(1 << 28);
+        const float cInverseScale = 1.0f / PathCodec::k_scale;
+
+        std::int32_t quantize(float value)
+        {
+            return static_cast<std::int32_t>(std::lround(std::clamp(value * PathCodec::k_scale, -cCoordinateLimit, cCoordinateLimit)));
+        }
+
+        std::uint32_t zigzag(std::int32_t value)
+        {
+            return (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31);
+        }
+
+        std::int32_t unzigzag(std::uint32_t value)
+        {
+            return static_cast<std::int32_t>(value >> 1) ^ -static_cast<std::int32_t>(value & 1);
+        }
+
+        void putVarint(std::vector<unsigned char> &output, std::uint32_t value)
+        {
+            while (value >= 0x80)
+            {
+                output.push_back(static_cast<unsigned char>(value | 0x80));
+                value >>= 7;
+            }
+            output.push_back(static_cast<unsigned char>(value));
+        }
+
+        // False past the end of the input or past five bytes
+        bool getVarint(const unsigned char *&input, const unsigned char *end, std::uint32_t &value)
+        {
+            value = 0;
+            for (int shift = 0; shift < 35 && input < end; shift += 7)
+            {
+                const unsigned char byte = *input++;
+                value |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+                if ((byte & 0x80) == 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void putU32(unsigned char *output, std::uint32_t value)
+        {
+            for (int i = 0; i < 4; ++i)
+            {
+                output[i] = static_cast<unsigned char>(value >> (8 * i));
+            }
+        }
+
+        std::uint32_t getU32(const unsigned char *input)
+        {
+            return static_cast<std::uint32_t>(input[0]) | static_cast<std::uint32_t>(input[1]) << 8 |
+                   static_cast<std::uint32_t>(input[2]) << 16 | static_cast<std::uint32_t>(input[3]) << 24;
+        }
+
+        // Block layout: number of color runs, the runs as (length, RGBA),
+        // then one record per segment. The record starts with the zigzag
+        // x delta of the segment shifted left by one, the low bit telling
+        // whether the start point is stored as well.
+        void encodeBlock(const ImVec4 *points, const ImColor *colors, size_t count, std::vector<unsigned char> &output)
+        {
+            std::vector<std::pair<std::uint32_t, ImU32>> runs;
+            for (size_t i = 0; i < count; ++i)
+            {
+                const ImU32 color = colors[i];
+                if (runs.empty() || runs.back().second != color)
+                {
+                    runs.push_back({0, color});
+                }
+                ++runs.back().first;
+            }
+
+            putVarint(output, static_cast<std::uint32_t>(runs.size()));
+            for (const auto &[length, color] : runs)
+            {
+                putVarint(output, length);
+                output.resize(output.size() + 4);
+                putU32(output.data() + output.size() - 4, color);
+            }
+
+            // The first segment of a block is a jump from the origin
+            std::int32_t lastX = 0;
+            std::int32_t lastY = 0;
+            bool first = true;
+            for (size_t i = 0; i < count; ++i)
+            {
+                const std::int32_t startX = quantize(points[i].x);
+                const std::int32_t startY = quantize(points[i].y);
+                const std::int32_t endX = quantize(points[i].z);
+                const std::int32_t endY = quantize(points[i].w);
+                const bool jump = first || startX != lastX || startY != lastY;
+
+                putVarint(output, zigzag(endX - startX) << 1 | (jump ? 1u : 0u));
+                putVarint(output, zigzag(endY - startY));
+                if (jump)
+                {
+                    putVarint(output, zigzag(startX - lastX));
+                    putVarint(output, zigzag(startY - lastY));
+                }
+
+                lastX = endX;
+                lastY = endY;
+                first = false;
+            }
+        }
+    }
+
+    // --------------------------------------------------
+    // PathCodec
+    // --------------------------------------------------
+    void PathCodec::encode(const ImVec4 *points, const ImColor *colors, size_t count, std::vector<unsigned char> &output)
+    {
+        const size_t base = output.size();
+        const size_t blockCount = getBlockCount(count);
+        output.resize(base + 4 * blockCount);
+
+        for (size_t block = 0; block < blockCount; ++block)
+        {
+            putU32(output.data() + base + 4 * block, static_cast<std::uint32_t>(output.size() - base));
+
+            const size_t first = block * k_blockSegments;
+            encodeBlock(points + first, colors + first, std::min(k_blockSegments, count - first), output);
+        }
+    }
+
+    bool PathCodec::decode(const unsigned char *data, size_t size, size_t count, ImVec4 *points, ImColor *colors)
+    {
+        for (size_t block = 0; block < getBlockCount(count); ++block)
+        {
+            const size_t first = block * k_blockSegments;
+            if (!decodeBlock(data, size, count, block, points + first, colors + first))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool PathCodec::decodeBlock(const unsigned char *data, size_t size, size_t count, size_t blockIndex, ImVec4 *points, ImColor *colors)
+    {
+        const size_t tableSize = 4 * getBlockCount(count);
+        if (blockIndex * k_blockSegments >= count || size < tableSize)
+        {
+            return false;
+        }
+        const size_t offset = getU32(data + 4 * blockIndex);
+        if (offset < tableSize || offset >= size)
+        {
+            return false;
+        }
+
+        const unsigned char *input = data + offset;
+        const unsigned char *end = data + size;
+        const size_t blockCount = std::min(k_blockSegments, count - blockIndex * k_blockSegments);
+
+        // The runs must cover the block exactly
+        std::uint32_t runCount = 0;
+        if (!getVarint(input, end, runCount))
+        {
+            return false;
+        }
+        size_t filled = 0;
+        for (std::uint32_t run = 0; run < runCount; ++run)
+        {
+            std::uint32_t length = 0;
+            if (!getVarint(input, end, length) || length > blockCount - filled || end - input < 4)
+            {
+                return false;
+            }
+            const ImColor color(getU32(input));
+            input += 4;
+            std::fill(colors + filled, colors + filled + length, color);
+            filled += length;
+        }
+        if (filled != blockCount)
+        {
+            return false;
+        }
+
+        // Sums wrap instead of overflowing on hostile deltas
+        std::uint32_t lastX = 0;
+        std::uint32_t lastY = 0;
+        for (size_t i = 0; i < blockCount; ++i)
+        {
+            std::uint32_t head = 0;
+            std::uint32_t deltaY = 0;
+            if (!getVarint(input, end, head) || !getVarint(input, end, deltaY))
+            {
+                return false;
+            }
+            if (head & 1)
+            {
+                std::uint32_t startX = 0;
+                std::uint32_t startY = 0;
+                if (!getVarint(input, end, startX) || !getVarint(input, end, startY))
+                {
+                    return false;
+                }
+                lastX += static_cast<std::uint32_t>(unzigzag(startX));
+                lastY += static_cast<std::uint32_t>(unzigzag(startY));
+            }
+
+            const std::uint32_t endX = lastX + static_cast<std::uint32_t>(unzigzag(head >> 1));
+            const std::uint32_t endY = lastY + static_cast<std::uint32_t>(unzigzag(deltaY));
+            points[i] = ImVec4(
+                static_cast<float>(static_cast<std::int32_t>(lastX)) * cInverseScale,
+                static_cast<float>(static_cast<std::int32_t>(lastY)) * cInverseScale,
+                static_cast<float>(static_cast<std::int32_t>(endX)) * cInverseScale,
+                static_cast<float>(static_cast<std::int32_t>(endY)) * cInverseScale);
+            lastX = endX;
+            lastY = endY;
+        }
+        return true;
+    }
+
+    size_t PathCodec::getBlockCount(size_t count)
+    {
+        return (count + k_blockSegments - 1) / k_blockSegments;
+    }
+
+    // Runs as (length, value), in loops the same node draws many segments
+    // in a row
+    void PathCodec::encodeTags(const std::uint32_t *tags, size_t count, std::vector<unsigned char> &output)
+    {
+        for (size_t i = 0; i < count;)
+        {
+            size_t end = i + 1;
+            while (end < count && tags[end] == tags[i])
+            {
+                ++end;
+            }
+            putVarint(output, static_cast<std::uint32_t>(end - i));
+            putVarint(output, tags[i]);
+            i = end;
+        }
+    }
+
+    bool PathCodec::decodeTags(const unsigned char *data, size_t size, size_t count, std::uint32_t *tags)
+    {
+        const unsigned char *input = data;
+        const unsigned char *end = data + size;
+        size_t filled = 0;
+        while (filled < count)
+        {
+            std::uint32_t length;
+            std::uint32_t value;
+            if (!getVarint(input, end, length) || !getVarint(input, end, value) || length == 0 || length > count - filled)
+            {
+                return false;
+            }
+            std::fill(tags + filled, tags + filled + length, value);
+            filled += length;
+        }
+        return input == end;
+    }
+
+} // namespace turtlepreter
@@ -0,0 +1,49 @@
+#ifndef TURTLEPRETER_PATH_CODEC_HPP
+#define TURTLEPRETER_PATH_CODEC_HPP
+
+#include <imgui/imgui.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace turtlepreter
+{
+
+    // --------------------------------------------------
+    // PathCodec
+    // --------------------------------------------------
+    // Compact encoding of a run of path segments. Coordinates are quantized
+    // to 1/16 of a pixel and stored as variable length deltas, a segment
+    // starting where the previous one ended stores only its end point.
+    // Colors are run-length encoded. Segments are grouped into blocks of a
+    // fixed size which are decoded independently, the encoding starts with
+    // a table of block offsets.
+    //
+    // Encodings may come from files, so decoding checks every offset,
+    // varint and color run against the size of the encoding.
+    //
+    // Tags, one 32-bit value per segment, have an encoding of their own,
+    // plain runs of equal values.
+    class PathCodec
+    {
+    public:
+        static constexpr size_t k_blockSegments = 256;
+        static constexpr float k_scale = 16.0f;
+
+        static void encode(const ImVec4 *points, const ImColor *colors, size_t count, std::vector<unsigned char> &output);
+
+        // Both decode the given encoding of size bytes and count segments,
+        // false if the encoding is corrupted
+        static bool decode(const unsigned char *data, size_t size, size_t count, ImVec4 *points, ImColor *colors);
+        static bool decodeBlock(const unsigned char *data, size_t size, size_t count, size_t blockIndex, ImVec4 *points, ImColor *colors);
+
+        static size_t getBlockCount(size_t count);
+
+        static void encodeTags(const std::uint32_t *tags, size_t count, std::vector<unsigned char> &output);
+        static bool decodeTags(const unsigned char *data, size_t size, size_t count, std::uint32_t *tags);
+    };
+
+} // namespace turtlepreter
+
+#endif
@@ -0,0 +1,149 @@
+#include "path_exporter.hpp"
+#include "turtle.hpp"
+
+#include <libfriimgui/buffered_writer.hpp>
+#include <libfriimgui/rasterizer.hpp>
+
+#include <algorithm>
+
+namespace turtlepreter
+{
+
+    namespace
+    {
+        const int cSvgPrecision = 2;
+
+        void writeHexByte(friimgui::BufferedWriter &writer, float value)
+        {
+            const char *digits = "0123456789abcdef";
+            const int byte = static_cast<int>(std::clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+            writer.write(digits[byte >> 4]).write(digits[byte & 0xF]);
+        }
+
+        void writePoint(friimgui::BufferedWriter &writer, float x, float y)
+        {
+            writer.write(x, cSvgPrecision).write(',').write(y, cSvgPrecision);
+        }
+
+        bool sameColor(const ImColor &a, const ImColor &b)
+        {
+            return a.Value.x == b.Value.x && a.Value.y == b.Value.y && a.Value.z == b.Value.z && a.Value.w == b.Value.w;
+        }
+    }
+
+    // --------------------------------------------------
+    // PathExporter
+    // --------------------------------------------------
+    void PathExporter::exportPng(
+        const Turtle &turtle,
+        const std::filesystem::path &fileName,
+        int width,
+        int height,
+        bool drawSprite)
+    {
+        const float thickness = 1.0f;
+        const PathStore &path = turtle.getPath();
+
+        friimgui::Bitmap bitmap(width, height, Turtle::k_canvasColor);
+        friimgui::Rasterizer rasterizer(width, height);
+
+        // One pass per chunk, the bins hold a single chunk at a time
+        for (size_t c = 0; c < path.getChunkCount(); c++)
+        {
+            const ImVec4 bounds = path.getChunkBounds(c);
+            if (bounds.z + thickness < 0 || bounds.x - thickness > width || bounds.w + thickness < 0 || bounds.y - thickness > height)
+            {
+                continue;
+            }
+
+            const PathStore::ChunkView chunk = path.getChunk(c);
+            rasterizer.clear();
+            for (size_t i = 0; i < chunk.count; i++)
+            {
+                rasterizer.addLine(chunk.points[i], chunk.colors[i], thickness);
+            }
+            rasterizer.render(bitmap);
+        }
+
+        if (drawSprite)
+        {
+            const friimgui::Bitmap sprite = friimgui::Bitmap::loadFromFile(turtle.getImagePath());
+            rasterizer.clear();
+            rasterizer.addImage(sprite, turtle.getTransformation());
+            rasterizer.render(bitmap);
+        }
+        bitmap.savePng(fileName);
+    }
+
+    void PathExporter::exportSvg(
+        const Turtle &turtle,
+        const std::filesystem::path &fileName,
+        int width,
+        int height)
+    {
+        friimgui::BufferedWriter writer(fileName);
+
+        writer.write("<svg xmlns=\"http://www.w3.org/2000/svg\" width=\"")
+            .write(static_cast<long long>(width))
+            .write("\" height=\"")
+            .write(static_cast<long long>(height))
+            .write("\" viewBox=\"0 0 ")
+            .write(static_cast<long long>(width))
+            .write(' ')
+            .write(static_cast<long long>(height))
+            .write("\">\n<rect width=\"100%\" height=\"100%\" fill=\"#3c3c3c\"/>\n");
+
+        const PathStore &path = turtle.getPath();
+        ImColor groupColor;
+        ImVec2 last;
+        bool first = true;
+        for (size_t c = 0; c < path.getChunkCount(); c++)
+        {
+            const PathStore::ChunkView chunk = path.getChunk(c);
+            for (size_t i = 0; i < chunk.count; i++)
+            {
+                const ImVec4 &segment = chunk.points[i];
+                const ImColor &color = chunk.colors[i];
+
+                const bool newGroup = first || !sameColor(color, groupColor);
+                const bool newPolyline = newGroup || segment.x != last.x || segment.y != last.y;
+
+                if (newPolyline && !first)
+                {
+                    writer.write("\"/>\n");
+                }
+                if (newGroup)
+                {
+                    if (!first)
+                    {
+                        writer.write("</g>\n");
+                    }
+                    writer.write("<g fill=\"none\" stroke-width=\"1\" stroke=\"#");
+                    writeHexByte(writer, color.Value.x);
+                    writeHexByte(writer, color.Value.y);
+                    writeHexByte(writer, color.Value.z);
+                    writer.write("\" stroke-opacity=\"").write(color.Value.w, cSvgPrecision).write("\">\n");
+                    groupColor = color;
+                }
+                if (newPolyline)
+                {
+                    writer.write("<polyline points=\"");
+                    writePoint(writer, segment.x, segment.y);
+                }
+
+                writer.write(' ');
+                writePoint(writer, segment.z, segment.w);
+                last = ImVec2(segment.z, segment.w);
+                first = false;
+            }
+        }
+
+        if (!first)
+        {
+            writer.write("\"/>\n</g>\n");
+        }
+        writer.write("</svg>\n");
+        writer.flush();
+    }
+
+} // namespace turtlepreter
@@ -0,0 +1,38 @@
+#ifndef TURTLEPRETER_PATH_EXPORTER_HPP
+#define TURTLEPRETER_PATH_EXPORTER_HPP
+
+#include <filesystem>
+
+namespace turtlepreter
+{
+    class Turtle;
+
+    // --------------------------------------------------
+    // PathExporter
+    // --------------------------------------------------
+    // Writes the drawing of a turtle into files, without any window or GL
+    // context.
+    class PathExporter
+    {
+    public:
+        // Renders the path chunk by chunk, so memory use does not depend on
+        // the path size beyond the bitmap.
+        static void exportPng(
+            const Turtle &turtle,
+            const std::filesystem::path &fileName,
+            int width,
+            int height,
+            bool drawSprite = true);
+
+        // Streams the path as SVG polylines, consecutive polylines of the same
+        // color share one group. Memory use does not depend on the path size.
+        static void exportSvg(
+            const Turtle &turtle,
+            const std::filesystem::path &fileName,
+            int width,
+            int height);
+    };
+
+} // namespace turtlepreter
+
+#endif
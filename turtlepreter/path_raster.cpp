@@ -0,0 +1,126 @@
+#include "path_raster.hpp"
+#include "path_store.hpp"
+
+#include <libfriimgui/window.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+
+namespace turtlepreter
+{
+
+    namespace
+    {
+        const float cThickness = 1.0f;
+        // Anti-aliased lines reach about a pixel past their ends
+        const float cMargin = cThickness + 1.0f;
+    }
+
+    // --------------------------------------------------
+    // PathRaster
+    // --------------------------------------------------
+    PathRaster::PathRaster(ImU32 background)
+        : m_background(background),
+          m_bitmap(),
+          m_rasterizer(),
+          m_texture(),
+          m_chunkCount(0),
+          m_stale(true)
+    {
+    }
+
+    size_t PathRaster::update(const PathStore &path, int width, int height)
+    {
+        if (!friimgui::Window::hasGLContext() || width <= 0 || height <= 0)
+        {
+            return 0;
+        }
+
+        const size_t fullChunks = path.size() / PathStore::k_chunkSegments;
+        if (!m_bitmap || m_bitmap->getWidth() != width || m_bitmap->getHeight() != height)
+        {
+            m_bitmap.emplace(width, height, m_background);
+            m_rasterizer.emplace(width, height);
+            m_chunkCount = 0;
+            m_stale = true;
+        }
+        else if (fullChunks < m_chunkCount)
+        {
+            clear();
+        }
+
+        int dirtyFirst = INT_MAX;
+        int dirtyEnd = INT_MIN;
+        const auto start = std::chrono::steady_clock::now();
+        while (m_chunkCount < fullChunks)
+        {
+            const ImVec4 bounds = path.getChunkBounds(m_chunkCount);
+            const bool visible = bounds.z + cMargin >= 0 && bounds.x - cMargin <= width && bounds.w + cMargin >= 0 && bounds.y - cMargin <= height;
+            if (visible)
+            {
+                const PathStore::ChunkView chunk = path.getChunk(m_chunkCount);
+                m_rasterizer->clear();
+                for (size_t i = 0; i < chunk.count; i++)
+                {
+                    m_rasterizer->addLine(chunk.points[i], chunk.colors[i], cThickness);
+                }
+                m_rasterizer->render(*m_bitmap);
+
+                dirtyFirst = std::min(dirtyFirst, static_cast<int>(std::floor(std::max(bounds.y - cMargin, 0.0f))));
+                dirtyEnd = std::max(dirtyEnd, static_cast<int>(std::ceil(std::min(bounds.w + cMargin, static_cast<float>(height)))));
+            }
+            m_chunkCount++;
+
+            const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed.count() >= k_budgetMs)
+            {
+                break;
+            }
+        }
+
+        if (m_stale)
+        {
+            m_texture.upload(*m_bitmap, 0, height);
+            m_stale = false;
+        }
+        else if (dirtyFirst < dirtyEnd)
+        {
+            m_texture.upload(*m_bitmap, dirtyFirst, dirtyEnd);
+        }
+        return m_chunkCount * PathStore::k_chunkSegments;
+    }
+
+    void PathRaster::draw(ImDrawList *drawList, ImVec2 p0) const
+    {
+        if (m_chunkCount == 0 || m_texture.getId() == 0)
+        {
+            return;
+        }
+        drawList->AddImage(
+            m_texture.getId(),
+            p0,
+            ImVec2(p0.x + m_bitmap->getWidth(), p0.y + m_bitmap->getHeight()));
+    }
+
+    void PathRaster::clear()
+    {
+        if (m_bitmap)
+        {
+            m_bitmap->clear(m_background);
+        }
+        m_chunkCount = 0;
+        m_stale = true;
+    }
+
+    size_t PathRaster::getMemoryBytes() const
+    {
+        if (!m_bitmap)
+        {
+            return 0;
+        }
+        return static_cast<size_t>(m_bitmap->getWidth()) * m_bitmap->getHeight() * sizeof(ImU32);
+    }
+
+} // namespace turtlepreter
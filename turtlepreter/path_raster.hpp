@@ -0,0 +1,56 @@
+#ifndef TURTLEPRETER_PATH_RASTER_HPP
+#define TURTLEPRETER_PATH_RASTER_HPP
+
+#include <libfriimgui/bitmap_texture.hpp>
+#include <libfriimgui/rasterizer.hpp>
+
+#include <imgui/imgui.h>
+
+#include <cstddef>
+#include <optional>
+
+namespace turtlepreter
+{
+    class PathStore;
+
+    // --------------------------------------------------
+    // PathRaster
+    // --------------------------------------------------
+    // Canvas sized raster of the full chunks of a PathStore, drawn as a
+    // single textured quad. Full chunks never change, so every chunk is
+    // rasterized once on the CPU and only the rows it touched are uploaded.
+    // Chunks lying outside the canvas are skipped without decoding them.
+    // The canvas has no zoom, so the raster at its own size is the only
+    // level of detail needed.
+    //
+    // Rasterizing is spread over frames by a time budget. Without a GL
+    // context, in headless windows, nothing is rasterized.
+    class PathRaster
+    {
+    public:
+        PathRaster(ImU32 background);
+
+        // Catches up with the path, returns how many segments the raster
+        // holds. The rest are left to be drawn as lines.
+        size_t update(const PathStore &path, int width, int height);
+        void draw(ImDrawList *drawList, ImVec2 p0) const;
+        void clear();
+
+        size_t getMemoryBytes() const;
+
+    private:
+        static constexpr double k_budgetMs = 4.0;
+
+        ImU32                               m_background;
+        std::optional<friimgui::Bitmap>     m_bitmap;
+        std::optional<friimgui::Rasterizer> m_rasterizer;
+        friimgui::BitmapTexture             m_texture;
+        // Full chunks rasterized or skipped as not visible
+        size_t                              m_chunkCount;
+        // The texture differs from the bitmap outside the dirty rows
+        bool                                m_stale;
+    };
+
+} // namespace turtlepreter
+
+#endif
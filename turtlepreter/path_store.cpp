@@ -0,0 +1,734 @@
+#include "path_store.hpp"
+#include "path_codec.hpp"
+
+#include <libfriimgui/buffered_writer.hpp>
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace turtlepreter
+{
+
+    // --------------------------------------------------
+    // BackingFile
+    // --------------------------------------------------
+    // Anonymous temporary file, removed by the system once it is closed.
+    class BackingFile
+    {
+    public:
+        BackingFile();
+        ~BackingFile();
+
+        BackingFile(const BackingFile &) = delete;
+        BackingFile &operator=(const BackingFile &) = delete;
+
+        void write(std::uint64_t offset, const void *data, size_t size);
+        // Offsets need not be aligned, unmap takes the same offset and size
+        const unsigned char *map(std::uint64_t offset, size_t size);
+        void unmap(const unsigned char *mapping, std::uint64_t offset, size_t size);
+
+    private:
+        static size_t getGranularity();
+
+#ifdef _WIN32
+        HANDLE m_handle;
+#else
+        int m_fd;
+#endif
+    };
+
+#ifdef _WIN32
+    BackingFile::BackingFile()
+    {
+        const std::filesystem::path dir = std::filesystem::temp_directory_path();
+        wchar_t name[MAX_PATH];
+        if (GetTempFileNameW(dir.c_str(), L"tpp", 0, name) == 0)
+        {
+            throw std::runtime_error("Failed to create path backing file");
+        }
+
+        m_handle = CreateFileW(
+            name,
+            GENERIC_READ | GENERIC_WRITE,
+            0,
+            nullptr,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+            nullptr);
+        if (m_handle == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("Failed to create path backing file");
+        }
+    }
+
+    BackingFile::~BackingFile()
+    {
+        CloseHandle(m_handle);
+    }
+
+    void BackingFile::write(std::uint64_t offset, const void *data, size_t size)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        while (size > 0)
+        {
+            OVERLAPPED overlapped = {};
+            overlapped.Offset = static_cast<DWORD>(offset);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+            DWORD written = 0;
+            const DWORD toWrite = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+            if (!WriteFile(m_handle, bytes, toWrite, &written, &overlapped) || written == 0)
+            {
+                throw std::runtime_error("Failed to write path backing file");
+            }
+            bytes += written;
+            offset += written;
+            size -= written;
+        }
+    }
+
+    size_t BackingFile::getGranularity()
+    {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwAllocationGranularity;
+    }
+
+    const unsigned char *BackingFile::map(std::uint64_t offset, size_t size)
+    {
+        const size_t skip = static_cast<size_t>(offset % getGranularity());
+        offset -= skip;
+        size += skip;
+
+        HANDLE mapping = CreateFileMappingW(m_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr)
+        {
+            throw std::runtime_error("Failed to map path backing file");
+        }
+
+        // The view keeps the mapping object alive
+        void *view = MapViewOfFile(
+            mapping,
+            FILE_MAP_READ,
+            static_cast<DWORD>(offset >> 32),
+            static_cast<DWORD>(offset),
+            size);
+        CloseHandle(mapping);
+        if (view == nullptr)
+        {
+            throw std::runtime_error("Failed to map path backing file");
+        }
+        return static_cast<const unsigned char *>(view) + skip;
+    }
+
+    void BackingFile::unmap(const unsigned char *mapping, std::uint64_t offset, size_t size)
+    {
+        (void)size;
+        UnmapViewOfFile(mapping - offset % getGranularity());
+    }
+#else
+    BackingFile::BackingFile()
+    {
+        std::string name = (std::filesystem::temp_directory_path() / "turtlepreter-path-XXXXXX").string();
+        m_fd = mkstemp(name.data());
+        if (m_fd < 0)
+        {
+            throw std::runtime_error("Failed to create path backing file");
+        }
+        unlink(name.c_str());
+    }
+
+    BackingFile::~BackingFile()
+    {
+        close(m_fd);
+    }
+
+    void BackingFile::write(std::uint64_t offset, const void *data, size_t size)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char *>(data);
+        while (size > 0)
+        {
+            const ssize_t written = pwrite(m_fd, bytes, size, static_cast<off_t>(offset));
+            if (written <= 0)
+            {
+                throw std::runtime_error("Failed to write path backing file");
+            }
+            bytes += written;
+            offset += written;
+            size -= written;
+        }
+    }
+
+    size_t BackingFile::getGranularity()
+    {
+        return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+
+    const unsigned char *BackingFile::map(std::uint64_t offset, size_t size)
+    {
+        const size_t skip = static_cast<size_t>(offset % getGranularity());
+        offset -= skip;
+        size += skip;
+
+        void *mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, m_fd, static_cast<off_t>(offset));
+        if (mapping == MAP_FAILED)
+        {
+            throw std::runtime_error("Failed to map path backing file");
+        }
+        return static_cast<const unsigned char *>(mapping) + skip;
+    }
+
+    void BackingFile::unmap(const unsigned char *mapping, std::uint64_t offset, size_t size)
+    {
+        const size_t skip = static_cast<size_t>(offset % getGranularity());
+        munmap(const_cast<unsigned char *>(mapping - skip), size + skip);
+    }
+#endif
+
+    namespace
+    {
+        const char cFileMagic[8] = {'T', 'U', 'R', 'T', 'P', 'A', 'T', 'H'};
+        const std::uint32_t cFileVersion = 1;
+
+        void writeLittleEndian(friimgui::BufferedWriter &writer, std::uint64_t value, int byteCount)
+        {
+            char bytes[8];
+            for (int i = 0; i < byteCount; ++i)
+            {
+                bytes[i] = static_cast<char>(value >> (8 * i));
+            }
+            writer.write(std::string_view(bytes, byteCount));
+        }
+
+        std::uint64_t readLittleEndian(std::istream &input, int byteCount)
+        {
+            unsigned char bytes[8] = {};
+            input.read(reinterpret_cast<char *>(bytes), byteCount);
+
+            std::uint64_t value = 0;
+            for (int i = byteCount - 1; i >= 0; --i)
+            {
+                value = value << 8 | bytes[i];
+            }
+            return value;
+        }
+
+        void extendBounds(ImVec4 &bounds, const ImVec4 &points)
+        {
+            bounds.x = std::min({bounds.x, points.x, points.z});
+            bounds.y = std::min({bounds.y, points.y, points.w});
+            bounds.z = std::max({bounds.z, points.x, points.z});
+            bounds.w = std::max({bounds.w, points.y, points.w});
+        }
+    }
+
+    // --------------------------------------------------
+    // PathStore
+    // --------------------------------------------------
+    PathStore::PathStore()
+        : m_chunks(),
+          m_mappedChunks(),
+          m_file(),
+          m_fileSize(0),
+          m_firstInMemory(0),
+          m_residentBytes(0),
+          m_spilledBytes(0),
+          m_useClock(0),
+          m_encodedBytes(0),
+          m_size(0),
+          m_residentLimit(k_unlimited),
+          m_decodedPoints(),
+          m_decodedColors(),
+          m_decodedChunk(SIZE_MAX),
+          m_blockPoints(),
+          m_blockColors(),
+          m_blockChunk(SIZE_MAX),
+          m_blockIndex(0),
+          m_decodedTags(),
+          m_tagChunk(SIZE_MAX)
+    {
+    }
+
+    PathStore::~PathStore()
+    {
+        clear();
+    }
+
+    PathStore::Chunk PathStore::makeChunk()
+    {
+        return {{}, {}, {}, {}, 0, 0, ImVec4(FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX), false, 0, false, false, nullptr, 0};
+    }
+
+    void PathStore::append(const ImVec4 &points, const ImColor &color, std::uint32_t tag)
+    {
+        if (m_size % k_chunkSegments == 0)
+        {
+            if (!m_chunks.empty() && !m_chunks.back().sealed)
+            {
+                seal(m_chunks.back());
+            }
+
+            Chunk chunk = makeChunk();
+            chunk.points.reserve(k_chunkSegments);
+            chunk.colors.reserve(k_chunkSegments);
+            m_chunks.push_back(std::move(chunk));
+            m_residentBytes += k_chunkBytes;
+
+            // The previous tail has just been sealed and may be spilled now
+            trimResident(m_chunks.size() - 1);
+        }
+
+        Chunk &tail = m_chunks.back();
+        if (tag != k_noTag && !tail.tagged)
+        {
+            tail.tags.reserve(k_chunkSegments);
+            tail.tags.assign(tail.points.size(), k_noTag);
+            tail.tagged = true;
+            m_residentBytes += k_chunkTagBytes;
+        }
+        tail.points.push_back(points);
+        tail.colors.push_back(color);
+        if (tail.tagged)
+        {
+            tail.tags.push_back(tag);
+        }
+        extendBounds(tail.bounds, points);
+        ++m_size;
+    }
+
+    void PathStore::clear()
+    {
+        for (size_t chunkIndex : m_mappedChunks)
+        {
+            const Chunk &chunk = m_chunks[chunkIndex];
+            m_file->unmap(chunk.mapping, chunk.fileOffset, chunk.encodedSize);
+        }
+        m_mappedChunks.clear();
+        m_chunks.clear();
+        m_file.reset();
+        m_fileSize = 0;
+        m_firstInMemory = 0;
+        m_residentBytes = 0;
+        m_spilledBytes = 0;
+        m_encodedBytes = 0;
+        m_size = 0;
+        m_decodedChunk = SIZE_MAX;
+        m_blockChunk = SIZE_MAX;
+        m_tagChunk = SIZE_MAX;
+    }
+
+    void PathStore::save(const std::filesystem::path &fileName) const
+    {
+        friimgui::BufferedWriter writer(fileName);
+        writer.write(std::string_view(cFileMagic, sizeof(cFileMagic)));
+        writeLittleEndian(writer, cFileVersion, 4);
+        writeLittleEndian(writer, k_chunkSegments, 4);
+        writeLittleEndian(writer, m_size, 8);
+
+        std::vector<unsigned char> tail;
+        for (size_t chunkIndex = 0; chunkIndex < m_chunks.size(); ++chunkIndex)
+        {
+            const Chunk &chunk = m_chunks[chunkIndex];
+            const unsigned char *data = nullptr;
+            size_t size = 0;
+            if (chunk.sealed)
+            {
+                data = getEncoded(chunkIndex);
+                size = chunk.pathSize;
+            }
+            else
+            {
+                PathCodec::encode(chunk.points.data(), chunk.colors.data(), chunk.points.size(), tail);
+                data = tail.data();
+                size = tail.size();
+            }
+
+            writeLittleEndian(writer, size, 8);
+            writer.write(std::string_view(reinterpret_cast<const char *>(data), size));
+        }
+        writer.flush();
+    }
+
+    void PathStore::load(const std::filesystem::path &fileName)
+    {
+        std::ifstream input(fileName, std::ios::binary);
+        if (!input)
+        {
+            throw std::runtime_error("Failed to open path file: " + fileName.string());
+        }
+
+        char magic[sizeof(cFileMagic)] = {};
+        input.read(magic, sizeof(magic));
+        const std::uint64_t version = readLittleEndian(input, 4);
+        const std::uint64_t chunkSegments = readLittleEndian(input, 4);
+        const std::uint64_t segmentCount = readLittleEndian(input, 8);
+        if (!input || !std::equal(magic, magic + sizeof(magic), cFileMagic) || version != cFileVersion || chunkSegments != k_chunkSegments)
+        {
+            throw std::runtime_error("Unsupported path file: " + fileName.string());
+        }
+
+        clear();
+        while (m_size < segmentCount)
+        {
+            const size_t count = static_cast<size_t>(std::min<std::uint64_t>(k_chunkSegments, segmentCount - m_size));
+
+            // An encoded chunk is never larger than the raw one
+            const std::uint64_t size = readLittleEndian(input, 8);
+            if (!input || size > k_chunkBytes)
+            {
+                clear();
+                throw std::runtime_error("Corrupted path file: " + fileName.string());
+            }
+
+            Chunk chunk = makeChunk();
+            chunk.encoded.resize(static_cast<size_t>(size));
+            input.read(reinterpret_cast<char *>(chunk.encoded.data()), static_cast<std::streamsize>(size));
+            if (!input)
+            {
+                clear();
+                throw std::runtime_error("Corrupted path file: " + fileName.string());
+            }
+
+            chunk.encodedSize = chunk.encoded.size();
+            chunk.pathSize = chunk.encodedSize;
+            chunk.sealed = true;
+            bool valid = false;
+            if (count < k_chunkSegments)
+            {
+                // The last chunk is appended to again, so it is kept decoded
+                chunk.points.reserve(k_chunkSegments);
+                chunk.colors.reserve(k_chunkSegments);
+                chunk.points.resize(count);
+                chunk.colors.resize(count);
+                valid = PathCodec::decode(chunk.encoded.data(), chunk.encodedSize, count, chunk.points.data(), chunk.colors.data());
+                std::vector<unsigned char>().swap(chunk.encoded);
+                chunk.encodedSize = 0;
+                chunk.pathSize = 0;
+                chunk.sealed = false;
+                for (size_t i = 0; valid && i < count; ++i)
+                {
+                    extendBounds(chunk.bounds, chunk.points[i]);
+                }
+            }
+            else
+            {
+                // Sealed chunks are checked now rather than on a later lazy
+                // decode, the decoded chunk stays cached
+                m_decodedPoints.resize(k_chunkSegments);
+                m_decodedColors.resize(k_chunkSegments);
+                valid = PathCodec::decode(chunk.encoded.data(), chunk.encodedSize, count, m_decodedPoints.data(), m_decodedColors.data());
+                m_decodedChunk = m_chunks.size();
+                for (size_t i = 0; valid && i < count; ++i)
+                {
+                    extendBounds(chunk.bounds, m_decodedPoints[i]);
+                }
+            }
+            if (!valid)
+            {
+                clear();
+                throw std::runtime_error("Corrupted path file: " + fileName.string());
+            }
+
+            m_residentBytes += chunk.sealed ? chunk.encodedSize : k_chunkBytes;
+            m_encodedBytes += chunk.encodedSize;
+            m_size += count;
+            m_chunks.push_back(std::move(chunk));
+            trimResident(m_chunks.size() - 1);
+        }
+    }
+
+    size_t PathStore::size() const
+    {
+        return m_size;
+    }
+
+    bool PathStore::empty() const
+    {
+        return m_size == 0;
+    }
+
+    ImVec4 PathStore::getPoints(size_t i) const
+    {
+        ImVec4 points;
+        locate(i, &points, nullptr);
+        return points;
+    }
+
+    ImColor PathStore::getColor(size_t i) const
+    {
+        ImColor color;
+        locate(i, nullptr, &color);
+        return color;
+    }
+
+    size_t PathStore::getChunkCount() const
+    {
+        return m_chunks.size();
+    }
+
+    PathStore::ChunkView PathStore::getChunk(size_t chunkIndex) const
+    {
+        const size_t count = getSegmentCount(chunkIndex);
+        const Chunk &chunk = m_chunks[chunkIndex];
+        if (!chunk.sealed)
+        {
+            return {chunk.points.data(), chunk.colors.data(), count};
+        }
+
+        if (m_decodedChunk != chunkIndex)
+        {
+            m_decodedPoints.resize(k_chunkSegments);
+            m_decodedColors.resize(k_chunkSegments);
+            m_decodedChunk = SIZE_MAX;
+            if (!PathCodec::decode(getEncoded(chunkIndex), chunk.pathSize, count, m_decodedPoints.data(), m_decodedColors.data()))
+            {
+                throw std::runtime_error("Corrupted path chunk");
+            }
+            m_decodedChunk = chunkIndex;
+        }
+        return {m_decodedPoints.data(), m_decodedColors.data(), count};
+    }
+
+    ImVec4 PathStore::getChunkBounds(size_t chunkIndex) const
+    {
+        return m_chunks[chunkIndex].bounds;
+    }
+
+    std::uint32_t PathStore::getTag(size_t i) const
+    {
+        const size_t chunkIndex = i / k_chunkSegments;
+        const size_t offset = i % k_chunkSegments;
+        const Chunk &chunk = m_chunks[chunkIndex];
+        if (!chunk.tagged)
+        {
+            return k_noTag;
+        }
+        if (!chunk.sealed)
+        {
+            return chunk.tags[offset];
+        }
+
+        if (m_tagChunk != chunkIndex)
+        {
+            m_decodedTags.resize(k_chunkSegments);
+            m_tagChunk = SIZE_MAX;
+            if (!PathCodec::decodeTags(getEncoded(chunkIndex) + chunk.pathSize, chunk.encodedSize - chunk.pathSize, getSegmentCount(chunkIndex), m_decodedTags.data()))
+            {
+                throw std::runtime_error("Corrupted path chunk");
+            }
+            m_tagChunk = chunkIndex;
+        }
+        return m_decodedTags[offset];
+    }
+
+    void PathStore::setResidentLimit(size_t bytes)
+    {
+        m_residentLimit = bytes;
+        if (!m_chunks.empty())
+        {
+            trimResident(m_chunks.size() - 1);
+        }
+    }
+
+    size_t PathStore::getResidentLimit() const
+    {
+        return m_residentLimit;
+    }
+
+    size_t PathStore::getResidentBytes() const
+    {
+        return m_residentBytes;
+    }
+
+    size_t PathStore::getSpilledBytes() const
+    {
+        return m_spilledBytes;
+    }
+
+    size_t PathStore::getEncodedBytes() const
+    {
+        return m_encodedBytes;
+    }
+
+    size_t PathStore::getSegmentCount(size_t chunkIndex) const
+    {
+        return std::min(k_chunkSegments, m_size - chunkIndex * k_chunkSegments);
+    }
+
+    const unsigned char *PathStore::getEncoded(size_t chunkIndex) const
+    {
+        const Chunk &chunk = m_chunks[chunkIndex];
+        if (!chunk.spilled)
+        {
+            return chunk.encoded.data();
+        }
+        pageIn(chunkIndex);
+        return chunk.mapping;
+    }
+
+    void PathStore::locate(size_t i, ImVec4 *points, ImColor *colors) const
+    {
+        const size_t chunkIndex = i / k_chunkSegments;
+        const size_t offset = i % k_chunkSegments;
+        const Chunk &chunk = m_chunks[chunkIndex];
+
+        const ImVec4 *chunkPoints = nullptr;
+        const ImColor *chunkColors = nullptr;
+        size_t index = offset;
+        if (!chunk.sealed)
+        {
+            chunkPoints = chunk.points.data();
+            chunkColors = chunk.colors.data();
+        }
+        else if (m_decodedChunk == chunkIndex)
+        {
+            chunkPoints = m_decodedPoints.data();
+            chunkColors = m_decodedColors.data();
+        }
+        else
+        {
+            // Only the block holding the segment is decoded, consecutive
+            // lookups mostly hit the same block
+            const size_t blockIndex = offset / PathCodec::k_blockSegments;
+            if (m_blockChunk != chunkIndex || m_blockIndex != blockIndex)
+            {
+                m_blockPoints.resize(PathCodec::k_blockSegments);
+                m_blockColors.resize(PathCodec::k_blockSegments);
+                m_blockChunk = SIZE_MAX;
+                const bool valid = PathCodec::decodeBlock(
+                    getEncoded(chunkIndex),
+                    chunk.pathSize,
+                    getSegmentCount(chunkIndex),
+                    blockIndex,
+                    m_blockPoints.data(),
+                    m_blockColors.data());
+                if (!valid)
+                {
+                    throw std::runtime_error("Corrupted path chunk");
+                }
+                m_blockChunk = chunkIndex;
+                m_blockIndex = blockIndex;
+            }
+            chunkPoints = m_blockPoints.data();
+            chunkColors = m_blockColors.data();
+            index = offset % PathCodec::k_blockSegments;
+        }
+
+        if (points != nullptr)
+        {
+            *points = chunkPoints[index];
+        }
+        if (colors != nullptr)
+        {
+            *colors = chunkColors[index];
+        }
+    }
+
+    void PathStore::seal(Chunk &chunk)
+    {
+        PathCodec::encode(chunk.points.data(), chunk.colors.data(), chunk.points.size(), chunk.encoded);
+        chunk.pathSize = chunk.encoded.size();
+        if (chunk.tagged)
+        {
+            PathCodec::encodeTags(chunk.tags.data(), chunk.tags.size(), chunk.encoded);
+            std::vector<std::uint32_t>().swap(chunk.tags);
+            m_residentBytes -= k_chunkTagBytes;
+        }
+        chunk.encoded.shrink_to_fit();
+        chunk.encodedSize = chunk.encoded.size();
+        chunk.sealed = true;
+        std::vector<ImVec4>().swap(chunk.points);
+        std::vector<ImColor>().swap(chunk.colors);
+
+        m_residentBytes = m_residentBytes - k_chunkBytes + chunk.encodedSize;
+        m_encodedBytes += chunk.encodedSize;
+    }
+
+    void PathStore::pageIn(size_t chunkIndex) const
+    {
+        Chunk &chunk = m_chunks[chunkIndex];
+        chunk.lastUse = ++m_useClock;
+        if (chunk.mapping == nullptr)
+        {
+            chunk.mapping = m_file->map(chunk.fileOffset, chunk.encodedSize);
+            m_mappedChunks.push_back(chunkIndex);
+            m_residentBytes += chunk.encodedSize;
+            trimResident(chunkIndex);
+        }
+    }
+
+    void PathStore::spill(size_t chunkIndex) const
+    {
+        if (!m_file)
+        {
+            m_file = std::make_unique<BackingFile>();
+        }
+
+        Chunk &chunk = m_chunks[chunkIndex];
+        chunk.fileOffset = m_fileSize;
+        m_file->write(chunk.fileOffset, chunk.encoded.data(), chunk.encodedSize);
+        m_fileSize += chunk.encodedSize;
+
+        std::vector<unsigned char>().swap(chunk.encoded);
+        chunk.spilled = true;
+        m_residentBytes -= chunk.encodedSize;
+        m_spilledBytes += chunk.encodedSize;
+    }
+
+    void PathStore::unmap(size_t chunkIndex) const
+    {
+        Chunk &chunk = m_chunks[chunkIndex];
+        m_file->unmap(chunk.mapping, chunk.fileOffset, chunk.encodedSize);
+        chunk.mapping = nullptr;
+        m_residentBytes -= chunk.encodedSize;
+        m_mappedChunks.erase(std::find(m_mappedChunks.begin(), m_mappedChunks.end(), chunkIndex));
+    }
+
+    void PathStore::trimResident(size_t pinnedChunk) const
+    {
+        while (m_residentBytes > m_residentLimit)
+        {
+            // Mapped chunks are cheap to drop, the least recently used goes first
+            size_t victim = SIZE_MAX;
+            for (size_t chunkIndex : m_mappedChunks)
+            {
+                if (chunkIndex != pinnedChunk && (victim == SIZE_MAX || m_chunks[chunkIndex].lastUse < m_chunks[victim].lastUse))
+                {
+                    victim = chunkIndex;
+                }
+            }
+            if (victim != SIZE_MAX)
+            {
+                unmap(victim);
+                continue;
+            }
+
+            // Otherwise the oldest sealed chunk still in memory is spilled,
+            // the tail being appended to never is
+            if (m_firstInMemory < m_chunks.size() && m_chunks[m_firstInMemory].sealed && m_firstInMemory != pinnedChunk)
+            {
+                spill(m_firstInMemory++);
+                continue;
+            }
+            break;
+        }
+    }
+
+} // namespace turtlepreter
@@ -0,0 +1,139 @@
+#ifndef TURTLEPRETER_PATH_STORE_HPP
+#define TURTLEPRETER_PATH_STORE_HPP
+
+#include <imgui/imgui.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+namespace turtlepreter
+{
+    class BackingFile;
+
+    // --------------------------------------------------
+    // PathStore
+    // --------------------------------------------------
+    // Append-only storage of path segments and their colors, kept in chunks
+    // of a fixed number of segments. Only the last chunk is stored as is,
+    // a full chunk is compressed by PathCodec, so older coordinates are
+    // rounded to 1/16 of a pixel. Once the resident memory exceeds the limit,
+    // the oldest chunks are written into a temporary backing file and mapped
+    // back into memory on demand. The same encoding is used by path files.
+    //
+    // Every segment may carry a tag, e.g. the node that drew it. Tags are
+    // encoded after the segments of a sealed chunk and spilled with them,
+    // but are not written into path files.
+    class PathStore
+    {
+    public:
+        static constexpr size_t k_chunkSegments = 1 << 16;
+        static constexpr size_t k_unlimited = SIZE_MAX;
+        static constexpr std::uint32_t k_noTag = UINT32_MAX;
+
+        struct ChunkView
+        {
+            const ImVec4 *points;
+            const ImColor *colors;
+            size_t count;
+        };
+
+        PathStore();
+        ~PathStore();
+
+        PathStore(const PathStore &) = delete;
+        PathStore &operator=(const PathStore &) = delete;
+
+        void append(const ImVec4 &points, const ImColor &color, std::uint32_t tag = k_noTag);
+        void clear();
+
+        void save(const std::filesystem::path &fileName) const;
+        void load(const std::filesystem::path &fileName);
+
+        size_t size() const;
+        bool empty() const;
+        ImVec4 getPoints(size_t i) const;
+        ImColor getColor(size_t i) const;
+        std::uint32_t getTag(size_t i) const;
+
+        // The view stays valid until the next call of a non-const method or
+        // of getChunk
+        size_t getChunkCount() const;
+        ChunkView getChunk(size_t chunkIndex) const;
+        // Box of the exact points as (minX, minY, maxX, maxY), the decoded
+        // points of a sealed chunk may lie up to 1/32 px outside
+        ImVec4 getChunkBounds(size_t chunkIndex) const;
+
+        void setResidentLimit(size_t bytes);
+        size_t getResidentLimit() const;
+        size_t getResidentBytes() const;
+        size_t getSpilledBytes() const;
+        size_t getEncodedBytes() const;
+
+    private:
+        static constexpr size_t k_chunkBytes = k_chunkSegments * (sizeof(ImVec4) + sizeof(ImColor));
+        static constexpr size_t k_chunkTagBytes = k_chunkSegments * sizeof(std::uint32_t);
+
+        struct Chunk
+        {
+            // Segments of the last chunk until it is sealed
+            std::vector<ImVec4> points;
+            std::vector<ImColor> colors;
+            // Only once a tagged segment is appended
+            std::vector<std::uint32_t> tags;
+
+            // Segments, then the tags if the chunk has any
+            std::vector<unsigned char> encoded;
+            size_t encodedSize;
+            size_t pathSize;
+            ImVec4 bounds;
+            bool tagged;
+            std::uint64_t fileOffset;
+            bool sealed;
+            bool spilled;
+            const unsigned char *mapping;
+            std::uint64_t lastUse;
+        };
+
+        static Chunk makeChunk();
+
+        size_t getSegmentCount(size_t chunkIndex) const;
+        const unsigned char *getEncoded(size_t chunkIndex) const;
+        void locate(size_t i, ImVec4 *points, ImColor *colors) const;
+
+        void seal(Chunk &chunk);
+        void pageIn(size_t chunkIndex) const;
+        void spill(size_t chunkIndex) const;
+        void unmap(size_t chunkIndex) const;
+        void trimResident(size_t pinnedChunk) const;
+
+        mutable std::vector<Chunk> m_chunks;
+        mutable std::vector<size_t> m_mappedChunks;
+        mutable std::unique_ptr<BackingFile> m_file;
+        mutable std::uint64_t m_fileSize;
+        mutable size_t m_firstInMemory;
+        mutable size_t m_residentBytes;
+        mutable size_t m_spilledBytes;
+        mutable std::uint64_t m_useClock;
+        size_t m_encodedBytes;
+        size_t m_size;
+        size_t m_residentLimit;
+
+        // Decoded sealed chunk handed out by getChunk and decoded block used
+        // by single segment lookups
+        mutable std::vector<ImVec4> m_decodedPoints;
+        mutable std::vector<ImColor> m_decodedColors;
+        mutable size_t m_decodedChunk;
+        mutable std::vector<ImVec4> m_blockPoints;
+        mutable std::vector<ImColor> m_blockColors;
+        mutable size_t m_blockChunk;
+        mutable size_t m_blockIndex;
+        mutable std::vector<std::uint32_t> m_decodedTags;
+        mutable size_t m_tagChunk;
+    };
+
+} // namespace turtlepreter
+
+#endif
@@ -129,9 +129,13 @@ namespace turtlepreter
         return;
     }
 
-    std::string CommandRun::toString()
+    void CommandRun::appendLabel(std::string &label) const
     {
-        return std::string("Utekaj na (") + std::to_string(m_dest.x) + ";" + std::to_string(m_dest.y) + ")";
+        label += "Utekaj na (";
+        appendLabelNumber(label, m_dest.x);
+        label += ';';
+        appendLabelNumber(label, m_dest.y);
+        label += ')';
     }
 
     bool CommandRun::canBeExecuted(Controllable &c)
@@ -159,9 +163,13 @@ namespace turtlepreter
         }
     }
 
-    std::string CommandSwim::toString()
+    void CommandSwim::appendLabel(std::string &label) const
     {
-        return std::string("Plavaj do (") + std::to_string(m_dest.x) + ";" + std::to_string(m_dest.y) + ")";
+        label += "Plavaj do (";
+        appendLabelNumber(label, m_dest.x);
+        label += ';';
+        appendLabelNumber(label, m_dest.y);
+        label += ')';
     }
 
     bool CommandSwim::canBeExecuted(Controllable &controllable)
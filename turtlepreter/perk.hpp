@@ -74,7 +74,7 @@ namespace turtlepreter
         CommandRun(ImVec2 dest);
 
         void execute(Controllable &controllable) override;
-        std::string toString() override;
+        void appendLabel(std::string &label) const override;
         bool canBeExecuted(Controllable &controllable) override;
 
     private:
@@ -90,7 +90,7 @@ namespace turtlepreter
         CommandSwim(ImVec2 dest);
 
         void execute(Controllable &controllable) override;
-        std::string toString() override;
+        void appendLabel(std::string &label) const override;
         bool canBeExecuted(Controllable &controllable) override;
 
     private:
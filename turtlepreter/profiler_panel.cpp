@@ -0,0 +1,226 @@
+#include "profiler_panel.hpp"
+
+#include <imgui/imgui.h>
+
+#include <algorithm>
+#include <string>
+
+namespace turtlepreter
+{
+
+    ProfilerPanel::ProfilerPanel(Interpreter *interpreter)
+        : m_interpreter(interpreter),
+          m_visible(false),
+          m_lastRefresh(),
+          m_entries(),
+          m_subtrees(),
+          m_executions(0),
+          m_failures(0),
+          m_sortColumn(Column::SubtreeTime),
+          m_sortAscending(false)
+    {
+    }
+
+    void ProfilerPanel::setVisible(bool visible)
+    {
+        m_visible = visible;
+        m_interpreter->setProfiling(visible);
+        m_entries.clear();
+        m_lastRefresh = std::chrono::steady_clock::time_point();
+    }
+
+    bool ProfilerPanel::isVisible() const
+    {
+        return m_visible;
+    }
+
+    Node *ProfilerPanel::build()
+    {
+        if (!m_visible)
+        {
+            return nullptr;
+        }
+
+        const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (m_lastRefresh == std::chrono::steady_clock::time_point() || now - m_lastRefresh >= k_refreshInterval)
+        {
+            m_lastRefresh = now;
+            refresh();
+        }
+
+        Node *clicked = nullptr;
+        ImGui::SetNextWindowSize(ImVec2(560, 400), ImGuiCond_FirstUseEver);
+        if (ImGui::Begin("Hot spots", &m_visible))
+        {
+            buildSummary();
+            clicked = buildTable();
+        }
+        ImGui::End();
+
+        // Closed by its title bar
+        if (!m_visible)
+        {
+            setVisible(false);
+        }
+        return clicked;
+    }
+
+    void ProfilerPanel::refresh()
+    {
+        m_entries.clear();
+        m_executions = 0;
+        m_failures = 0;
+
+        const std::vector<NodeProfile> &profiles = m_interpreter->getProfiles();
+        const std::size_t nodeCount = m_interpreter->getNodeCount();
+        if (profiles.size() != nodeCount)
+        {
+            return;
+        }
+
+        // Parents are indexed before their subnodes, so one pass from the
+        // last node adds every subtree into its parent
+        m_subtrees.assign(nodeCount, Subtree());
+        for (std::size_t i = nodeCount; i-- > 0;)
+        {
+            Subtree &subtree = m_subtrees[i];
+            subtree.executions += profiles[i].executions;
+            subtree.seconds += profiles[i].getEstimatedSeconds();
+            if (const Node *parent = m_interpreter->getNode(static_cast<std::uint32_t>(i))->getParent())
+            {
+                m_subtrees[parent->getIndex()].executions += subtree.executions;
+                m_subtrees[parent->getIndex()].seconds += subtree.seconds;
+            }
+        }
+
+        for (std::size_t i = 0; i < nodeCount; ++i)
+        {
+            const NodeProfile &profile = profiles[i];
+            m_executions += profile.executions;
+            m_failures += profile.failures;
+            if (m_subtrees[i].executions > 0)
+            {
+                Node *node = m_interpreter->getNode(static_cast<std::uint32_t>(i));
+                m_entries.push_back({node, profile, profile.getEstimatedSeconds(), m_subtrees[i].seconds});
+            }
+        }
+        sort();
+    }
+
+    void ProfilerPanel::sort()
+    {
+        const Column column = m_sortColumn;
+        Interpreter *interpreter = m_interpreter;
+        auto less = [column, interpreter](const Entry &a, const Entry &b)
+        {
+            switch (column)
+            {
+            case Column::Node:
+                return interpreter->getLabel(a.node) < interpreter->getLabel(b.node);
+            case Column::Executions:
+                return a.profile.executions < b.profile.executions;
+            case Column::Failures:
+                return a.profile.failures < b.profile.failures;
+            case Column::Time:
+                return a.seconds < b.seconds;
+            case Column::SubtreeTime:
+                return a.subtreeSeconds < b.subtreeSeconds;
+            case Column::Output:
+                return a.profile.getEstimatedOutputGrowth() < b.profile.getEstimatedOutputGrowth();
+            }
+            return false;
+        };
+
+        // Ties keep the order of the program
+        if (m_sortAscending)
+        {
+            std::stable_sort(m_entries.begin(), m_entries.end(), less);
+        }
+        else
+        {
+            std::stable_sort(m_entries.begin(), m_entries.end(), [&less](const Entry &a, const Entry &b)
+                             { return less(b, a); });
+        }
+    }
+
+    void ProfilerPanel::buildSummary()
+    {
+        ImGui::Text("Executions: %llu, failed: %llu",
+                    static_cast<unsigned long long>(m_executions),
+                    static_cast<unsigned long long>(m_failures));
+        ImGui::SameLine();
+        if (ImGui::Button("Clear"))
+        {
+            m_interpreter->clearProfiles();
+            refresh();
+        }
+        ImGui::TextDisabled("Times and output are estimated from a sample of the executions");
+    }
+
+    Node *ProfilerPanel::buildTable()
+    {
+        const ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable | ImGuiTableFlags_Sortable | ImGuiTableFlags_ScrollY;
+        if (!ImGui::BeginTable("##hotspots", k_columnCount, flags))
+        {
+            return nullptr;
+        }
+
+        const ImGuiTableColumnFlags numeric = ImGuiTableColumnFlags_PreferSortDescending;
+        ImGui::TableSetupScrollFreeze(0, 1);
+        ImGui::TableSetupColumn("Node", ImGuiTableColumnFlags_WidthStretch, 0, static_cast<ImGuiID>(Column::Node));
+        ImGui::TableSetupColumn("Runs", numeric, 0, static_cast<ImGuiID>(Column::Executions));
+        ImGui::TableSetupColumn("Failed", numeric, 0, static_cast<ImGuiID>(Column::Failures));
+        ImGui::TableSetupColumn("Time", numeric, 0, static_cast<ImGuiID>(Column::Time));
+        ImGui::TableSetupColumn("Subtree", numeric | ImGuiTableColumnFlags_DefaultSort, 0, static_cast<ImGuiID>(Column::SubtreeTime));
+        ImGui::TableSetupColumn("Output", numeric, 0, static_cast<ImGuiID>(Column::Output));
+        ImGui::TableHeadersRow();
+
+        if (ImGuiTableSortSpecs *specs = ImGui::TableGetSortSpecs())
+        {
+            if (specs->SpecsDirty && specs->SpecsCount > 0)
+            {
+                m_sortColumn = static_cast<Column>(specs->Specs[0].ColumnUserID);
+                m_sortAscending = specs->Specs[0].SortDirection == ImGuiSortDirection_Ascending;
+                sort();
+            }
+            specs->SpecsDirty = false;
+        }
+
+        Node *clicked = nullptr;
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(m_entries.size()));
+        while (clipper.Step())
+        {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+            {
+                const Entry &entry = m_entries[i];
+                ImGui::TableNextRow();
+
+                ImGui::TableSetColumnIndex(0);
+                ImGui::PushID(entry.node);
+                const std::string &label = m_interpreter->getLabel(entry.node);
+                if (ImGui::Selectable(label.c_str(), false, ImGuiSelectableFlags_SpanAllColumns))
+                {
+                    clicked = entry.node;
+                }
+                ImGui::PopID();
+
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%llu", static_cast<unsigned long long>(entry.profile.executions));
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%llu", static_cast<unsigned long long>(entry.profile.failures));
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%.3f ms", entry.seconds * 1000);
+                ImGui::TableSetColumnIndex(4);
+                ImGui::Text("%.3f ms", entry.subtreeSeconds * 1000);
+                ImGui::TableSetColumnIndex(5);
+                ImGui::Text("%.0f", entry.profile.getEstimatedOutputGrowth());
+            }
+        }
+        clipper.End();
+
+        ImGui::EndTable();
+        return clicked;
+    }
+
+} // namespace turtlepreter
@@ -0,0 +1,86 @@
+#ifndef TURTLEPRETER_PROFILER_PANEL_HPP
+#define TURTLEPRETER_PROFILER_PANEL_HPP
+
+#include "interpreter.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace turtlepreter
+{
+
+    // --------------------------------------------------
+    // ProfilerPanel
+    // --------------------------------------------------
+    // Window with the hot spots of the program, read from the profiles of
+    // the interpreter. Opening it turns profiling on, closing it turns it
+    // off again, so a hidden panel costs nothing.
+    //
+    // The table lists the nodes whose subtree ran, sortable by any column.
+    // Subtree time adds the time of all descendants, so sequences show what
+    // their whole body cost. The rows are collected every k_refreshInterval and
+    // sorted again only when the order changes.
+    class ProfilerPanel
+    {
+    public:
+        ProfilerPanel(Interpreter *interpreter);
+
+        void setVisible(bool visible);
+        bool isVisible() const;
+
+        // Draws the window if visible, to be called inside a frame.
+        // Returns the node clicked in the table, if any.
+        Node *build();
+
+    private:
+        struct Subtree
+        {
+            std::uint64_t executions;
+            double seconds;
+        };
+
+        struct Entry
+        {
+            Node *node;
+            NodeProfile profile;
+            double seconds;
+            double subtreeSeconds;
+        };
+
+        enum class Column
+        {
+            Node,
+            Executions,
+            Failures,
+            Time,
+            SubtreeTime,
+            Output
+        };
+
+        static constexpr int k_columnCount = 6;
+        static constexpr std::chrono::milliseconds k_refreshInterval{500};
+
+        void refresh();
+        void sort();
+        void buildSummary();
+        Node *buildTable();
+
+        Interpreter *m_interpreter;
+        bool m_visible;
+
+        std::chrono::steady_clock::time_point m_lastRefresh;
+        std::vector<Entry> m_entries;
+        // Indexed by Node::getIndex(), kept to not allocate every refresh
+        std::vector<Subtree> m_subtrees;
+        std::uint64_t m_executions;
+        std::uint64_t m_failures;
+
+        Column m_sortColumn;
+        bool m_sortAscending;
+    };
+
+} // namespace turtlepreter
+
+#endif
@@ -0,0 +1,262 @@
+#include "segment_index.hpp"
+#include "path_store.hpp"
+
+#include <algorithm>
+#include <cfloat>
+
+namespace turtlepreter
+{
+
+    namespace
+    {
+        float segmentDistanceSq(const ImVec4 &segment, ImVec2 point)
+        {
+            const float dx = segment.z - segment.x;
+            const float dy = segment.w - segment.y;
+            const float lengthSq = dx * dx + dy * dy;
+
+            float t = 0.0f;
+            if (lengthSq > 0.0f)
+            {
+                t = ((point.x - segment.x) * dx + (point.y - segment.y) * dy) / lengthSq;
+                t = std::clamp(t, 0.0f, 1.0f);
+            }
+
+            const float ex = segment.x + t * dx - point.x;
+            const float ey = segment.y + t * dy - point.y;
+            return ex * ex + ey * ey;
+        }
+    }
+
+    // --------------------------------------------------
+    // SegmentIndex
+    // --------------------------------------------------
+    SegmentIndex::SegmentIndex()
+        : m_groupBoxes(),
+          m_trees()
+    {
+    }
+
+    void SegmentIndex::update(const PathStore &path)
+    {
+        if (path.size() < getIndexedCount())
+        {
+            clear();
+        }
+
+        const std::size_t groupCount = path.size() / k_groupSegments;
+        if (groupCount == m_groupBoxes.size())
+        {
+            return;
+        }
+
+        // Merge with every older tree that is not bigger than the new one,
+        // which keeps the number of trees logarithmic
+        Tree tree;
+        tree.begin = m_groupBoxes.size();
+        tree.end = groupCount;
+        while (!m_trees.empty() && m_trees.back().end - m_trees.back().begin <= tree.end - tree.begin)
+        {
+            tree.begin = m_trees.back().begin;
+            m_trees.pop_back();
+        }
+
+        addGroups(path, groupCount);
+        buildTree(tree);
+        m_trees.push_back(std::move(tree));
+    }
+
+    void SegmentIndex::clear()
+    {
+        m_groupBoxes.clear();
+        m_trees.clear();
+    }
+
+    std::size_t SegmentIndex::getIndexedCount() const
+    {
+        return m_groupBoxes.size() * k_groupSegments;
+    }
+
+    std::optional<std::size_t> SegmentIndex::findNearest(const PathStore &path, ImVec2 point, float maxDistance) const
+    {
+        float bestDistSq = maxDistance * maxDistance;
+        std::optional<std::size_t> best;
+
+        for (const Tree &tree : m_trees)
+        {
+            queryTree(tree, path, point, bestDistSq, best);
+        }
+        queryRange(path, std::min(getIndexedCount(), path.size()), path.size(), point, bestDistSq, best);
+        return best;
+    }
+
+    void SegmentIndex::addGroups(const PathStore &path, std::size_t groupCount)
+    {
+        // Groups never cross chunks, every chunk is decoded once
+        while (m_groupBoxes.size() < groupCount)
+        {
+            const std::size_t first = m_groupBoxes.size() * k_groupSegments;
+            const std::size_t chunkIndex = first / PathStore::k_chunkSegments;
+            const PathStore::ChunkView chunk = path.getChunk(chunkIndex);
+
+            for (std::size_t offset = first % PathStore::k_chunkSegments; offset + k_groupSegments <= chunk.count && m_groupBoxes.size() < groupCount; offset += k_groupSegments)
+            {
+                Box box = {FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX};
+                for (std::size_t i = offset; i < offset + k_groupSegments; ++i)
+                {
+                    const ImVec4 &s = chunk.points[i];
+                    box.minX = std::min({box.minX, s.x, s.z});
+                    box.minY = std::min({box.minY, s.y, s.w});
+                    box.maxX = std::max({box.maxX, s.x, s.z});
+                    box.maxY = std::max({box.maxY, s.y, s.w});
+                }
+
+                // Groups of the open chunk are boxed from the exact points,
+                // which move by up to half a quantization step once sealed
+                box.minX -= k_boxPadding;
+                box.minY -= k_boxPadding;
+                box.maxX += k_boxPadding;
+                box.maxY += k_boxPadding;
+                m_groupBoxes.push_back(box);
+            }
+        }
+    }
+
+    void SegmentIndex::buildTree(Tree &tree)
+    {
+        const std::size_t count = tree.end - tree.begin;
+
+        tree.groups.resize(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            tree.groups[i] = static_cast<std::uint32_t>(tree.begin + i);
+        }
+
+        tree.nodes.clear();
+        tree.nodes.reserve(2 * (count / k_leafSize + 1));
+        buildNode(tree, 0, static_cast<std::uint32_t>(count));
+    }
+
+    std::uint32_t SegmentIndex::buildNode(Tree &tree, std::uint32_t first, std::uint32_t count)
+    {
+        BvhNode node = {{FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX}, first, count, 0};
+        float centerMin[2] = {FLT_MAX, FLT_MAX};
+        float centerMax[2] = {-FLT_MAX, -FLT_MAX};
+
+        auto center = [this](std::uint32_t group, int axis)
+        {
+            const Box &box = m_groupBoxes[group];
+            return axis == 0 ? box.minX + box.maxX : box.minY + box.maxY;
+        };
+
+        for (std::uint32_t i = first; i < first + count; ++i)
+        {
+            const Box &b = m_groupBoxes[tree.groups[i]];
+            node.box.minX = std::min(node.box.minX, b.minX);
+            node.box.minY = std::min(node.box.minY, b.minY);
+            node.box.maxX = std::max(node.box.maxX, b.maxX);
+            node.box.maxY = std::max(node.box.maxY, b.maxY);
+            for (int axis = 0; axis < 2; ++axis)
+            {
+                centerMin[axis] = std::min(centerMin[axis], center(tree.groups[i], axis));
+                centerMax[axis] = std::max(centerMax[axis], center(tree.groups[i], axis));
+            }
+        }
+
+        const std::uint32_t nodeIndex = static_cast<std::uint32_t>(tree.nodes.size());
+        tree.nodes.push_back(node);
+        if (count <= k_leafSize)
+        {
+            return nodeIndex;
+        }
+
+        // Median split along the longer extent of the group centers
+        const int axis = centerMax[0] - centerMin[0] >= centerMax[1] - centerMin[1] ? 0 : 1;
+        const std::uint32_t half = count / 2;
+        std::nth_element(
+            tree.groups.begin() + first,
+            tree.groups.begin() + first + half,
+            tree.groups.begin() + first + count,
+            [&center, axis](std::uint32_t a, std::uint32_t b)
+            {
+                return center(a, axis) < center(b, axis);
+            });
+
+        buildNode(tree, first, half);
+        const std::uint32_t right = buildNode(tree, first + half, count - half);
+
+        tree.nodes[nodeIndex].count = 0;
+        tree.nodes[nodeIndex].right = right;
+        return nodeIndex;
+    }
+
+    void SegmentIndex::queryTree(const Tree &tree, const PathStore &path, ImVec2 point, float &bestDistSq, std::optional<std::size_t> &best) const
+    {
+        if (tree.nodes.empty())
+        {
+            return;
+        }
+
+        auto boxDistanceSq = [&point](const Box &box)
+        {
+            const float dx = std::max({box.minX - point.x, 0.0f, point.x - box.maxX});
+            const float dy = std::max({box.minY - point.y, 0.0f, point.y - box.maxY});
+            return dx * dx + dy * dy;
+        };
+
+        std::uint32_t stack[64];
+        int top = 0;
+        stack[top++] = 0;
+
+        while (top > 0)
+        {
+            const std::uint32_t nodeIndex = stack[--top];
+            const BvhNode &node = tree.nodes[nodeIndex];
+            if (boxDistanceSq(node.box) > bestDistSq)
+            {
+                continue;
+            }
+
+            if (node.count > 0)
+            {
+                for (std::uint32_t i = node.first; i < node.first + node.count; ++i)
+                {
+                    const std::size_t group = tree.groups[i];
+                    if (boxDistanceSq(m_groupBoxes[group]) <= bestDistSq)
+                    {
+                        queryRange(path, group * k_groupSegments, (group + 1) * k_groupSegments, point, bestDistSq, best);
+                    }
+                }
+                continue;
+            }
+
+            // Visit the closer child first so the farther one is pruned more often
+            const std::uint32_t left = nodeIndex + 1;
+            const std::uint32_t right = node.right;
+            if (boxDistanceSq(tree.nodes[left].box) < boxDistanceSq(tree.nodes[right].box))
+            {
+                stack[top++] = right;
+                stack[top++] = left;
+            }
+            else
+            {
+                stack[top++] = left;
+                stack[top++] = right;
+            }
+        }
+    }
+
+    void SegmentIndex::queryRange(const PathStore &path, std::size_t first, std::size_t end, ImVec2 point, float &bestDistSq, std::optional<std::size_t> &best) const
+    {
+        for (std::size_t i = first; i < end; ++i)
+        {
+            const float distSq = segmentDistanceSq(path.getPoints(i), point);
+            if (distSq <= bestDistSq)
+            {
+                bestDistSq = distSq;
+                best = i;
+            }
+        }
+    }
+
+} // namespace turtlepreter
@@ -0,0 +1,85 @@
+#ifndef TURTLEPRETER_SEGMENT_INDEX_HPP
+#define TURTLEPRETER_SEGMENT_INDEX_HPP
+
+#include "path_codec.hpp"
+
+#include <imgui/imgui.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace turtlepreter
+{
+    class PathStore;
+
+    // --------------------------------------------------
+    // SegmentIndex
+    // --------------------------------------------------
+    // Spatial index answering nearest segment queries over the append-only
+    // segments of a PathStore. The index holds no segments, only the
+    // bounding box of every group of k_groupSegments consecutive segments,
+    // which are read back from the store when a query reaches the group.
+    // A group is one block of the path encoding, so reading it decodes a
+    // single block. Turtle paths are drawn in strokes, consecutive segments
+    // lie close to each other and so do the boxes.
+    //
+    // The boxes of appended groups are collected into bounding volume
+    // hierarchies of doubling sizes, so both appends (amortized) and queries
+    // stay logarithmic. Segments after the last full group are scanned.
+    class SegmentIndex
+    {
+    public:
+        static constexpr std::size_t k_groupSegments = PathCodec::k_blockSegments;
+
+        SegmentIndex();
+
+        void update(const PathStore &path);
+        void clear();
+
+        std::size_t getIndexedCount() const;
+        std::optional<std::size_t> findNearest(const PathStore &path, ImVec2 point, float maxDistance) const;
+
+    private:
+        struct Box
+        {
+            float minX;
+            float minY;
+            float maxX;
+            float maxY;
+        };
+
+        struct BvhNode
+        {
+            Box box;
+            std::uint32_t first;
+            std::uint32_t count;
+            std::uint32_t right;
+        };
+
+        struct Tree
+        {
+            std::size_t begin;
+            std::size_t end;
+            std::vector<BvhNode> nodes;
+            // Indices of the groups, ordered by the hierarchy
+            std::vector<std::uint32_t> groups;
+        };
+
+        static constexpr std::uint32_t k_leafSize = 4;
+        static constexpr float k_boxPadding = 1.0f / PathCodec::k_scale;
+
+        void addGroups(const PathStore &path, std::size_t groupCount);
+        void buildTree(Tree &tree);
+        std::uint32_t buildNode(Tree &tree, std::uint32_t first, std::uint32_t count);
+        void queryTree(const Tree &tree, const PathStore &path, ImVec2 point, float &bestDistSq, std::optional<std::size_t> &best) const;
+        void queryRange(const PathStore &path, std::size_t first, std::size_t end, ImVec2 point, float &bestDistSq, std::optional<std::size_t> &best) const;
+
+        std::vector<Box> m_groupBoxes;
+        std::vector<Tree> m_trees;
+    };
+
+} // namespace turtlepreter
+
+#endif
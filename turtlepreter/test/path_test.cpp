@@ -0,0 +1,330 @@
+#include "path_codec.hpp"
+#include "path_store.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Checks the path encoding and the spilling path store: round trips within
+// the quantization error, color runs across blocks, a partial last block,
+// saving and loading a spilled multi-chunk path, tags spilled with their
+// chunks, and the rejection of truncated and corrupted files.
+namespace
+{
+    using namespace turtlepreter;
+
+    // Half of the 1/16 px quantization step
+    const float cMaxError = 1.0f / 32.0f + 1e-4f;
+
+    int g_failures = 0;
+
+    void check(bool condition, const char *what)
+    {
+        if (!condition)
+        {
+            std::printf("FAILED: %s\n", what);
+            ++g_failures;
+        }
+    }
+
+    // Random walk of strokes with occasional jumps, the color changes every
+    // colorRun segments so runs cross the block boundaries
+    void makePath(size_t count, size_t colorRun, std::vector<ImVec4> &points, std::vector<ImColor> &colors)
+    {
+        std::mt19937 random(7);
+        std::uniform_real_distribution<float> step(-4.0f, 4.0f);
+        std::uniform_real_distribution<float> position(0.0f, 2000.0f);
+
+        points.clear();
+        colors.clear();
+        float x = 1000.0f;
+        float y = 1000.0f;
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (random() % 64 == 0)
+            {
+                x = position(random);
+                y = position(random);
+            }
+            const float endX = x + step(random);
+            const float endY = y + step(random);
+            points.push_back(ImVec4(x, y, endX, endY));
+            colors.push_back(ImColor(static_cast<int>(i / colorRun % 256), 128, 255 - static_cast<int>(i / colorRun % 256)));
+            x = endX;
+            y = endY;
+        }
+    }
+
+    bool isClose(const ImVec4 &a, const ImVec4 &b)
+    {
+        return std::fabs(a.x - b.x) <= cMaxError && std::fabs(a.y - b.y) <= cMaxError &&
+               std::fabs(a.z - b.z) <= cMaxError && std::fabs(a.w - b.w) <= cMaxError;
+    }
+
+    bool isSameColor(const ImColor &a, const ImColor &b)
+    {
+        return static_cast<ImU32>(a) == static_cast<ImU32>(b);
+    }
+
+    void testRoundTrip()
+    {
+        // Three full blocks and a partial one
+        const size_t count = 3 * PathCodec::k_blockSegments + 77;
+        std::vector<ImVec4> points;
+        std::vector<ImColor> colors;
+        makePath(count, 100, points, colors);
+
+        std::vector<unsigned char> encoded;
+        PathCodec::encode(points.data(), colors.data(), count, encoded);
+
+        std::vector<ImVec4> decodedPoints(count);
+        std::vector<ImColor> decodedColors(count);
+        check(PathCodec::decode(encoded.data(), encoded.size(), count, decodedPoints.data(), decodedColors.data()), "round trip decodes");
+
+        bool close = true;
+        bool sameColors = true;
+        for (size_t i = 0; i < count; ++i)
+        {
+            close = close && isClose(points[i], decodedPoints[i]);
+            sameColors = sameColors && isSameColor(colors[i], decodedColors[i]);
+        }
+        check(close, "round trip within 1/32 px");
+        check(sameColors, "round trip keeps colors");
+
+        // Every block alone, the runs of 100 segments cross each boundary
+        std::vector<ImVec4> blockPoints(PathCodec::k_blockSegments);
+        std::vector<ImColor> blockColors(PathCodec::k_blockSegments);
+        for (size_t block = 0; block < PathCodec::getBlockCount(count); ++block)
+        {
+            check(PathCodec::decodeBlock(encoded.data(), encoded.size(), count, block, blockPoints.data(), blockColors.data()), "block decodes");
+            const size_t first = block * PathCodec::k_blockSegments;
+            const size_t blockCount = std::min(PathCodec::k_blockSegments, count - first);
+            bool same = true;
+            for (size_t i = 0; i < blockCount; ++i)
+            {
+                same = same && blockPoints[i].x == decodedPoints[first + i].x && blockPoints[i].w == decodedPoints[first + i].w &&
+                       isSameColor(blockColors[i], colors[first + i]);
+            }
+            check(same, "block matches the whole decode");
+        }
+        check(!PathCodec::decodeBlock(encoded.data(), encoded.size(), count, PathCodec::getBlockCount(count), blockPoints.data(), blockColors.data()), "block past the end is rejected");
+    }
+
+    void testCorruptedEncoding()
+    {
+        const size_t count = 2 * PathCodec::k_blockSegments + 10;
+        std::vector<ImVec4> points;
+        std::vector<ImColor> colors;
+        makePath(count, 50, points, colors);
+
+        std::vector<unsigned char> encoded;
+        PathCodec::encode(points.data(), colors.data(), count, encoded);
+        std::vector<ImVec4> decodedPoints(count);
+        std::vector<ImColor> decodedColors(count);
+
+        bool truncatedRejected = true;
+        for (size_t size = 0; size < encoded.size(); ++size)
+        {
+            const std::vector<unsigned char> truncated(encoded.begin(), encoded.begin() + size);
+            truncatedRejected = truncatedRejected && !PathCodec::decode(truncated.data(), truncated.size(), count, decodedPoints.data(), decodedColors.data());
+        }
+        check(truncatedRejected, "every truncated encoding is rejected");
+
+        std::vector<unsigned char> badOffset = encoded;
+        badOffset[4] = 0xFF;
+        badOffset[7] = 0x7F;
+        check(!PathCodec::decode(badOffset.data(), badOffset.size(), count, decodedPoints.data(), decodedColors.data()), "block offset past the end is rejected");
+
+        // The first block starts after the table with the run count, then
+        // the length of the first run
+        const size_t tableSize = 4 * PathCodec::getBlockCount(count);
+        std::vector<unsigned char> longRun = encoded;
+        longRun[tableSize + 1] = 0x7F;
+        check(!PathCodec::decode(longRun.data(), longRun.size(), count, decodedPoints.data(), decodedColors.data()), "run past the block is rejected");
+
+        std::vector<unsigned char> shortRun = encoded;
+        shortRun[tableSize + 1] -= 1;
+        check(!PathCodec::decode(shortRun.data(), shortRun.size(), count, decodedPoints.data(), decodedColors.data()), "runs short of the block are rejected");
+
+        // Random damage may decode to other segments, but never reads or
+        // writes past the buffers
+        std::mt19937 random(11);
+        for (int i = 0; i < 20000; ++i)
+        {
+            std::vector<unsigned char> damaged = encoded;
+            for (int flip = 0; flip < 4; ++flip)
+            {
+                damaged[random() % damaged.size()] ^= static_cast<unsigned char>(1u << (random() % 8));
+            }
+            PathCodec::decode(damaged.data(), damaged.size(), count, decodedPoints.data(), decodedColors.data());
+        }
+    }
+
+    void testTags()
+    {
+        // Tags start within the first chunk and run across spilled chunks
+        const size_t count = 3 * PathStore::k_chunkSegments + 500;
+        const size_t firstTagged = 1000;
+        std::vector<ImVec4> points;
+        std::vector<ImColor> colors;
+        makePath(count, 100, points, colors);
+
+        auto tagOf = [](size_t i)
+        {
+            return static_cast<std::uint32_t>(i / 3 % 7 == 0 ? i : i / 50);
+        };
+
+        PathStore store;
+        store.setResidentLimit(1 << 20);
+        for (size_t i = 0; i < count; ++i)
+        {
+            store.append(points[i], colors[i], i < firstTagged ? PathStore::k_noTag : tagOf(i));
+        }
+        check(store.getSpilledBytes() > 0, "tagged chunks are spilled");
+
+        bool sameTags = true;
+        for (size_t i = 0; i < count; ++i)
+        {
+            sameTags = sameTags && store.getTag(i) == (i < firstTagged ? PathStore::k_noTag : tagOf(i));
+        }
+        check(sameTags, "tags read back");
+        check(isClose(store.getPoints(count / 2), points[count / 2]), "segments of tagged chunks");
+
+        std::vector<unsigned char> encoded;
+        std::vector<std::uint32_t> tags(PathCodec::k_blockSegments + 3, 5);
+        tags[100] = 6;
+        PathCodec::encodeTags(tags.data(), tags.size(), encoded);
+        std::vector<std::uint32_t> decoded(tags.size());
+        check(PathCodec::decodeTags(encoded.data(), encoded.size(), tags.size(), decoded.data()) && decoded == tags, "tag round trip");
+        check(!PathCodec::decodeTags(encoded.data(), encoded.size() - 1, tags.size(), decoded.data()), "truncated tags are rejected");
+        check(!PathCodec::decodeTags(encoded.data(), encoded.size(), tags.size() + 1, decoded.data()), "missing tags are rejected");
+    }
+
+    std::vector<char> readFile(const std::filesystem::path &fileName)
+    {
+        std::ifstream input(fileName, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(const std::filesystem::path &fileName, const std::vector<char> &data)
+    {
+        std::ofstream output(fileName, std::ios::binary | std::ios::trunc);
+        output.write(data.data(), static_cast<std::streamsize>(data.size()));
+    }
+
+    bool loadFails(const std::filesystem::path &fileName)
+    {
+        PathStore store;
+        try
+        {
+            store.load(fileName);
+        }
+        catch (const std::runtime_error &)
+        {
+            return store.empty();
+        }
+        return false;
+    }
+
+    void testSaveLoad(const std::filesystem::path &dir)
+    {
+        // Three full chunks and a partial one, a limit of two sealed chunks
+        const size_t count = 3 * PathStore::k_chunkSegments + 1234;
+        const size_t limit = 1 << 20;
+        std::vector<ImVec4> points;
+        std::vector<ImColor> colors;
+        makePath(count, 1000, points, colors);
+
+        PathStore store;
+        store.setResidentLimit(limit);
+        for (size_t i = 0; i < count; ++i)
+        {
+            store.append(points[i], colors[i]);
+        }
+        check(store.getSpilledBytes() > 0, "chunks are spilled");
+
+        const std::filesystem::path fileName = dir / "path_test.tpath";
+        store.save(fileName);
+
+        PathStore loaded;
+        loaded.setResidentLimit(limit);
+        loaded.load(fileName);
+        check(loaded.size() == count, "loaded segment count");
+        check(loaded.getSpilledBytes() > 0, "loaded chunks are spilled");
+
+        bool close = true;
+        bool sameColors = true;
+        bool bounded = true;
+        for (size_t c = 0; c < loaded.getChunkCount(); ++c)
+        {
+            const PathStore::ChunkView chunk = loaded.getChunk(c);
+            const ImVec4 bounds = loaded.getChunkBounds(c);
+            for (size_t i = 0; i < chunk.count; ++i)
+            {
+                const size_t index = c * PathStore::k_chunkSegments + i;
+                const ImVec4 &s = chunk.points[i];
+                close = close && isClose(points[index], s);
+                sameColors = sameColors && isSameColor(colors[index], chunk.colors[i]);
+                bounded = bounded && std::min(s.x, s.z) >= bounds.x && std::min(s.y, s.w) >= bounds.y &&
+                          std::max(s.x, s.z) <= bounds.z && std::max(s.y, s.w) <= bounds.w;
+            }
+        }
+        check(close, "loaded path within 1/32 px");
+        check(sameColors, "loaded path keeps colors");
+        check(bounded, "chunk bounds hold the loaded segments");
+        check(isClose(loaded.getPoints(17), points[17]) && isClose(loaded.getPoints(count - 1), points[count - 1]), "single segment lookups");
+
+        loaded.append(points[0], colors[0]);
+        check(loaded.size() == count + 1 && isClose(loaded.getPoints(count), points[0]), "appending after a load");
+        check(loaded.getTag(17) == PathStore::k_noTag, "loaded segments have no tags");
+
+        // Header, then a size and the bytes of every chunk
+        const std::vector<char> file = readFile(fileName);
+        const size_t headerSize = 24;
+        const std::filesystem::path damagedName = dir / "path_test_damaged.tpath";
+
+        bool truncatedRejected = true;
+        for (size_t size : {size_t(0), size_t(10), headerSize, headerSize + 5, headerSize + 8, headerSize + 100, file.size() / 2, file.size() - 1})
+        {
+            writeFile(damagedName, std::vector<char>(file.begin(), file.begin() + size));
+            truncatedRejected = truncatedRejected && loadFails(damagedName);
+        }
+        check(truncatedRejected, "truncated files are rejected");
+
+        // An empty first chunk
+        std::vector<char> emptyChunk(file.begin(), file.begin() + headerSize);
+        emptyChunk.resize(headerSize + 8, 0);
+        writeFile(damagedName, emptyChunk);
+        check(loadFails(damagedName), "empty chunk is rejected");
+
+        // The first block offset of the first chunk, validated on load
+        // although the chunk is sealed
+        std::vector<char> badOffset = file;
+        badOffset[headerSize + 8 + 3] = 0x7F;
+        writeFile(damagedName, badOffset);
+        check(loadFails(damagedName), "corrupted sealed chunk is rejected");
+
+        std::filesystem::remove(fileName);
+        std::filesystem::remove(damagedName);
+    }
+}
+
+int main()
+{
+    const std::filesystem::path dir = std::filesystem::temp_directory_path();
+
+    testRoundTrip();
+    testCorruptedEncoding();
+    testTags();
+    testSaveLoad(dir);
+
+    std::printf(g_failures == 0 ? "All path tests passed\n" : "%d path checks failed\n", g_failures);
+    return g_failures == 0 ? 0 : 1;
+}
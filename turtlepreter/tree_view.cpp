@@ -0,0 +1,277 @@
+#include "tree_view.hpp"
+
+#include <imgui/imgui.h>
+
+#include <algorithm>
+#include <string>
+
+namespace turtlepreter
+{
+
+    namespace
+    {
+        const ImVec4 cCurrentNodeColor(0.4f, 1.0f, 0.4f, 1.0f);
+        const ImVec4 cHeatColor(1.0f, 0.25f, 0.1f, 0.6f);
+
+        // Fills the row at the cursor, more opaque the hotter it is
+        void drawHeat(ImDrawList *drawList, double heat, float width, float height)
+        {
+            if (heat <= 0)
+            {
+                return;
+            }
+
+            ImVec4 color = cHeatColor;
+            color.w *= static_cast<float>(heat);
+            const ImVec2 p0 = ImGui::GetCursorScreenPos();
+            drawList->AddRectFilled(p0, ImVec2(p0.x + width, p0.y + height), ImGui::GetColorU32(color));
+        }
+    }
+
+    TreeView::TreeView(Interpreter *interpreter)
+        : m_interpreter(interpreter),
+          m_root(nullptr),
+          m_nodeCount(0),
+          m_rows(),
+          m_expanded(),
+          m_rowOfNode(),
+          m_scrollTarget(nullptr)
+    {
+    }
+
+    void TreeView::build(const Node *selectedNode, const Node *currentNode)
+    {
+        update();
+
+        const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+        if (m_scrollTarget != nullptr)
+        {
+            const std::size_t row = findRow(m_scrollTarget);
+            const float top = row * rowHeight;
+            const float windowHeight = ImGui::GetWindowHeight();
+            const float scroll = ImGui::GetScrollY();
+            if (row < m_rows.size() && (top < scroll || top + 2 * rowHeight > scroll + windowHeight))
+            {
+                ImGui::SetScrollY(std::max(0.0f, top - (windowHeight - rowHeight) / 2));
+            }
+            m_scrollTarget = nullptr;
+        }
+
+        // Rows change only after the loop, the clipper expects a fixed count
+        std::size_t toggledRow = m_rows.size();
+        const float startX = ImGui::GetCursorPosX();
+        const float indent = ImGui::GetStyle().IndentSpacing;
+
+        // Heat is the sampled time of the node relative to the hottest one
+        const std::vector<NodeProfile> &profiles = m_interpreter->getProfiles();
+        const double maxNanoseconds = static_cast<double>(m_interpreter->getMaxTimedNanoseconds());
+        const bool heatmap = profiles.size() == m_nodeCount && maxNanoseconds > 0;
+        ImDrawList *drawList = ImGui::GetWindowDrawList();
+        const float rowWidth = ImGui::GetContentRegionAvail().x;
+
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(m_rows.size()), rowHeight);
+        while (clipper.Step())
+        {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i)
+            {
+                const Row &row = m_rows[i];
+                const bool leaf = row.node->getSubnodes().empty();
+                const bool expanded = isExpanded(row.node);
+
+                ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_NoTreePushOnOpen;
+                if (leaf)
+                {
+                    flags |= ImGuiTreeNodeFlags_Leaf;
+                }
+                if (row.node == selectedNode)
+                {
+                    flags |= ImGuiTreeNodeFlags_Selected;
+                }
+
+                const bool current = row.node == currentNode;
+                if (current)
+                {
+                    ImGui::PushStyleColor(ImGuiCol_Text, cCurrentNodeColor);
+                }
+
+                if (heatmap)
+                {
+                    drawHeat(drawList, profiles[row.node->getIndex()].timedNanoseconds / maxNanoseconds, rowWidth, rowHeight);
+                }
+
+                ImGui::SetCursorPosX(startX + row.depth * indent);
+                ImGui::SetNextItemOpen(expanded);
+                const std::string &label = m_interpreter->getLabel(row.node);
+                const bool open = ImGui::TreeNodeEx(row.node, flags, "%s", label.c_str());
+                if (current)
+                {
+                    ImGui::PopStyleColor();
+                }
+                if (!leaf && open != expanded)
+                {
+                    toggledRow = i;
+                }
+            }
+        }
+        clipper.End();
+
+        if (toggledRow < m_rows.size())
+        {
+            if (isExpanded(m_rows[toggledRow].node))
+            {
+                collapse(toggledRow);
+            }
+            else
+            {
+                expand(toggledRow);
+            }
+        }
+    }
+
+    void TreeView::reveal(const Node *node)
+    {
+        update();
+        if (node == nullptr)
+        {
+            return;
+        }
+
+        // The topmost collapsed ancestor has a row, expanding it adds the rows
+        // of the next one. Nothing is allocated while following a node whose
+        // ancestors are expanded.
+        for (;;)
+        {
+            const Node *collapsed = nullptr;
+            for (const Node *n = node->getParent(); n != nullptr; n = n->getParent())
+            {
+                if (!isExpanded(n))
+                {
+                    collapsed = n;
+                }
+            }
+            const std::size_t row = collapsed != nullptr ? findRow(collapsed) : m_rows.size();
+            if (row >= m_rows.size())
+            {
+                break;
+            }
+            expand(row);
+        }
+        m_scrollTarget = node;
+    }
+
+    void TreeView::update()
+    {
+        if (m_interpreter->getRoot() != m_root || m_interpreter->getNodeCount() != m_nodeCount)
+        {
+            rebuild();
+        }
+    }
+
+    void TreeView::rebuild()
+    {
+        m_root = m_interpreter->getRoot();
+        m_nodeCount = m_interpreter->getNodeCount();
+        m_expanded.assign(m_nodeCount, 1);
+        m_rowOfNode.assign(m_nodeCount, k_hiddenRow);
+        m_rows.clear();
+        m_scrollTarget = nullptr;
+        if (m_root != nullptr)
+        {
+            appendSubtreeRows(m_interpreter->getRoot(), 0, m_rows);
+        }
+        indexRows(0);
+    }
+
+    void TreeView::expand(std::size_t rowIndex)
+    {
+        if (rowIndex >= m_rows.size() || m_rows[rowIndex].node->getIndex() >= m_expanded.size())
+        {
+            return;
+        }
+
+        const Row row = m_rows[rowIndex];
+        m_expanded[row.node->getIndex()] = 1;
+
+        std::vector<Row> subtreeRows;
+        for (Node *subnode : row.node->getSubnodes())
+        {
+            appendSubtreeRows(subnode, row.depth + 1, subtreeRows);
+        }
+        m_rows.insert(m_rows.begin() + rowIndex + 1, subtreeRows.begin(), subtreeRows.end());
+        indexRows(rowIndex + 1);
+    }
+
+    void TreeView::collapse(std::size_t rowIndex)
+    {
+        const Row row = m_rows[rowIndex];
+        if (row.node->getIndex() >= m_expanded.size())
+        {
+            return;
+        }
+        m_expanded[row.node->getIndex()] = 0;
+
+        std::size_t end = rowIndex + 1;
+        while (end < m_rows.size() && m_rows[end].depth > row.depth)
+        {
+            if (m_rows[end].node->getIndex() < m_rowOfNode.size())
+            {
+                m_rowOfNode[m_rows[end].node->getIndex()] = k_hiddenRow;
+            }
+            ++end;
+        }
+        m_rows.erase(m_rows.begin() + rowIndex + 1, m_rows.begin() + end);
+        indexRows(rowIndex + 1);
+    }
+
+    void TreeView::appendSubtreeRows(Node *node, std::uint32_t depth, std::vector<Row> &rows) const
+    {
+        // Iterative, deep programs would overflow the stack
+        std::vector<Row> pending;
+        pending.push_back({node, depth});
+        while (!pending.empty())
+        {
+            const Row row = pending.back();
+            pending.pop_back();
+            rows.push_back(row);
+
+            if (isExpanded(row.node))
+            {
+                const std::vector<Node *> &subnodes = row.node->getSubnodes();
+                for (auto it = subnodes.rbegin(); it != subnodes.rend(); ++it)
+                {
+                    pending.push_back({*it, row.depth + 1});
+                }
+            }
+        }
+    }
+
+    void TreeView::indexRows(std::size_t firstRow)
+    {
+        // Nodes added since the rebuild have no slot until the next one
+        for (std::size_t i = firstRow; i < m_rows.size(); ++i)
+        {
+            const std::uint32_t index = m_rows[i].node->getIndex();
+            if (index < m_rowOfNode.size())
+            {
+                m_rowOfNode[index] = static_cast<std::uint32_t>(i);
+            }
+        }
+    }
+
+    std::size_t TreeView::findRow(const Node *node) const
+    {
+        const std::uint32_t index = node->getIndex();
+        if (index < m_rowOfNode.size() && m_rowOfNode[index] != k_hiddenRow)
+        {
+            return m_rowOfNode[index];
+        }
+        return m_rows.size();
+    }
+
+    bool TreeView::isExpanded(const Node *node) const
+    {
+        return node->getIndex() < m_expanded.size() && m_expanded[node->getIndex()] != 0;
+    }
+
+} // namespace turtlepreter
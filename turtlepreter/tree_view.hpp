@@ -0,0 +1,72 @@
+#ifndef TURTLEPRETER_TREE_VIEW_HPP
+#define TURTLEPRETER_TREE_VIEW_HPP
+
+#include "interpreter.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace turtlepreter
+{
+
+    // --------------------------------------------------
+    // TreeView
+    // --------------------------------------------------
+    // Tree of the program nodes drawn as a flat list of rows. Only nodes
+    // whose ancestors are all expanded have a row, and only the rows in
+    // view are drawn, so a frame costs the same for any size of program.
+    //
+    // Expanding or collapsing a node inserts or erases just the rows of its
+    // subtree. The rows are rebuilt only when the interpreter indexes a
+    // different tree. Nodes start expanded. The row of every node is kept
+    // in an index, so following a node never searches the rows.
+    //
+    // While the interpreter profiles, the background of each row shows how
+    // much time its node took.
+    class TreeView
+    {
+    public:
+        TreeView(Interpreter *interpreter);
+
+        // Draws the rows into the current window, highlighting the selected
+        // node, the node executed next and, while profiling, the hot nodes.
+        void build(const Node *selectedNode, const Node *currentNode);
+
+        // Expands the ancestors of the node and scrolls to it in the next
+        // build(), unless its row is already in view.
+        void reveal(const Node *node);
+
+    private:
+        struct Row
+        {
+            Node *node;
+            std::uint32_t depth;
+        };
+
+        static constexpr std::uint32_t k_hiddenRow = UINT32_MAX;
+
+        void update();
+        void rebuild();
+        void expand(std::size_t rowIndex);
+        void collapse(std::size_t rowIndex);
+        void appendSubtreeRows(Node *node, std::uint32_t depth, std::vector<Row> &rows) const;
+        void indexRows(std::size_t firstRow);
+        std::size_t findRow(const Node *node) const;
+        bool isExpanded(const Node *node) const;
+
+        Interpreter *m_interpreter;
+        const Node *m_root;
+        std::size_t m_nodeCount;
+
+        std::vector<Row> m_rows;
+        // Both indexed by Node::getIndex()
+        std::vector<std::uint8_t> m_expanded;
+        std::vector<std::uint32_t> m_rowOfNode;
+
+        const Node *m_scrollTarget;
+    };
+
+} // namespace turtlepreter
+
+#endif
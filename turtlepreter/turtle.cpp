@@ -5,6 +5,7 @@
 
 #include <stdexcept>
 
+#include <algorithm>
 #include <cmath>
 
 namespace turtlepreter
@@ -37,12 +38,14 @@ namespace turtlepreter
     // +++++++++++++++++++++++++++++++++++++++
 
     Turtle::Turtle(const std::string &imgPath)
-        : Controllable(imgPath), m_color(ImColor(0, 255, 0)), m_path_color()
+        : Controllable(imgPath), m_path(), m_color(ImColor(0, 255, 0)),
+          m_provenanceEnabled(false), m_provenance(0), m_provenanceBase(0), m_segmentIndex(), m_raster(k_canvasColor)
     {
     }
 
     Turtle::Turtle(const std::string &imgPath, float centerX, float centerY)
-        : Controllable(imgPath, centerX, centerY), m_color(ImColor(0, 255, 0)), m_path_color()
+        : Controllable(imgPath, centerX, centerY), m_path(), m_color(ImColor(0, 255, 0)),
+          m_provenanceEnabled(false), m_provenance(0), m_provenanceBase(0), m_segmentIndex(), m_raster(k_canvasColor)
     {
     }
 
@@ -51,16 +54,43 @@ namespace turtlepreter
         const float thickness = 1.0f;
         ImDrawList *drawList = ImGui::GetWindowDrawList();
         const ImVec2 p0 = region.getP0();
+        const ImVec2 size = region.calculateSize();
 
-        for (size_t i = 0; i < getPathSegmentCount(); i++)
-        {
-            const ImVec4 lines = getPathSegmentPoints(i);
+        const size_t rastered = m_raster.update(m_path, static_cast<int>(size.x), static_cast<int>(size.y));
+        m_raster.draw(drawList, p0);
+
+        // Segments not in the raster are drawn as lines, unless they lie
+        // outside the clip rectangle
+        const ImVec2 clipMin = drawList->GetClipRectMin();
+        const ImVec2 clipMax = drawList->GetClipRectMax();
+        const float minX = clipMin.x - p0.x - thickness;
+        const float minY = clipMin.y - p0.y - thickness;
+        const float maxX = clipMax.x - p0.x + thickness;
+        const float maxY = clipMax.y - p0.y + thickness;
 
-            drawList->AddLine(
-                ImVec2(p0.x + lines.x, p0.y + lines.y),
-                ImVec2(p0.x + lines.z, p0.y + lines.w),
-                m_path_color.at(i),
-                thickness);
+        for (size_t c = rastered / PathStore::k_chunkSegments; c < m_path.getChunkCount(); c++)
+        {
+            const ImVec4 bounds = m_path.getChunkBounds(c);
+            if (bounds.z < minX || bounds.x > maxX || bounds.w < minY || bounds.y > maxY)
+            {
+                continue;
+            }
+
+            const PathStore::ChunkView chunk = m_path.getChunk(c);
+            for (size_t i = 0; i < chunk.count; i++)
+            {
+                const ImVec4 &lines = chunk.points[i];
+                if (std::max(lines.x, lines.z) < minX || std::min(lines.x, lines.z) > maxX || std::max(lines.y, lines.w) < minY || std::min(lines.y, lines.w) > maxY)
+                {
+                    continue;
+                }
+
+                drawList->AddLine(
+                    ImVec2(p0.x + lines.x, p0.y + lines.y),
+                    ImVec2(p0.x + lines.z, p0.y + lines.w),
+                    chunk.colors[i],
+                    thickness);
+            }
         }
 
         Controllable::draw(region);
@@ -69,9 +99,11 @@ namespace turtlepreter
     void Turtle::reset()
     {
         Controllable::reset();
-        path.clear();
+        m_path.clear();
         m_transformation.rotation.resetValue();
-        m_path_color.clear();
+        m_provenanceBase = 0;
+        m_segmentIndex.clear();
+        m_raster.clear();
         m_color = ImColor(0, 255, 0);
     }
 
@@ -79,18 +111,21 @@ namespace turtlepreter
     {
         ImVec2 orig = m_transformation.translation.getValueOrDef();
         ImVec2 dest(orig.x + distance, orig.y);
-        path.push_back(ImVec4(orig.x, orig.y, dest.x, dest.y));
+        pushPathSegment(orig, dest);
         m_transformation.translation.setValue(dest);
-        m_path_color.push_back(m_color);
     }
 
     void Turtle::jump(float x, float y)
     {
         ImVec2 orig = m_transformation.translation.getValueOrDef();
         ImVec2 dest(x, y);
-        path.push_back(ImVec4(orig.x, orig.y, dest.x, dest.y));
+        pushPathSegment(orig, dest);
         m_transformation.translation.setValue(dest);
-        m_path_color.push_back(m_color);
+    }
+
+    void Turtle::pushPathSegment(ImVec2 orig, ImVec2 dest)
+    {
+        m_path.append(ImVec4(orig.x, orig.y, dest.x, dest.y), m_color, m_provenanceEnabled ? m_provenance : PathStore::k_noTag);
     }
 
     void Turtle::rotate(float angleRad)
@@ -100,7 +135,7 @@ namespace turtlepreter
 
     size_t Turtle::getPathSegmentCount() const
     {
-        size_t to_return = path.size();
+        size_t to_return = m_path.size();
         return to_return;
     }
 
@@ -108,7 +143,7 @@ namespace turtlepreter
     {
         if (getPathSegmentCount() > i)
         {
-            ImVec4 to_return = path.at(i);
+            ImVec4 to_return = m_path.getPoints(i);
             return to_return;
         }
         return ImVec4();
@@ -118,18 +153,101 @@ namespace turtlepreter
     {
         if (getPathSegmentCount() > i)
         {
-            ImColor to_return = m_path_color.at(i);
+            ImColor to_return = m_path.getColor(i);
             return to_return;
         }
 
         return ImColor();
     }
 
+    const PathStore &Turtle::getPath() const
+    {
+        return m_path;
+    }
+
+    size_t Turtle::getPathMemoryBytes() const
+    {
+        return m_path.getResidentBytes() + m_raster.getMemoryBytes();
+    }
+
+    void Turtle::setPathResidentLimit(size_t bytes)
+    {
+        m_path.setResidentLimit(bytes);
+    }
+
+    void Turtle::savePath(const std::filesystem::path &fileName) const
+    {
+        m_path.save(fileName);
+    }
+
+    void Turtle::loadPath(const std::filesystem::path &fileName)
+    {
+        m_segmentIndex.clear();
+        m_raster.clear();
+        m_path.load(fileName);
+
+        // Loaded segments were not drawn by the current script
+        m_provenanceBase = m_path.size();
+        if (!m_path.empty())
+        {
+            const ImVec4 last = m_path.getPoints(m_path.size() - 1);
+            m_transformation.translation.setValue(ImVec2(last.z, last.w));
+        }
+    }
+
     void Turtle::setColor(ImColor color)
     {
         this->m_color = color;
     }
 
+    size_t Turtle::getOutputSize() const
+    {
+        return getPathSegmentCount();
+    }
+
+    void Turtle::setProvenance(std::uint32_t provenance)
+    {
+        m_provenance = provenance;
+    }
+
+    void Turtle::setProvenanceEnabled(bool enabled)
+    {
+        if (m_provenanceEnabled == enabled)
+        {
+            return;
+        }
+
+        // Segments drawn while disabled have no known origin, recording
+        // starts with the next segment
+        m_provenanceEnabled = enabled;
+        m_provenanceBase = m_path.size();
+    }
+
+    bool Turtle::isProvenanceEnabled() const
+    {
+        return m_provenanceEnabled;
+    }
+
+    std::optional<std::uint32_t> Turtle::getPathSegmentProvenance(size_t i) const
+    {
+        if (!m_provenanceEnabled || i < m_provenanceBase || i >= m_path.size())
+        {
+            return std::nullopt;
+        }
+        const std::uint32_t provenance = m_path.getTag(i);
+        if (provenance == PathStore::k_noTag)
+        {
+            return std::nullopt;
+        }
+        return provenance;
+    }
+
+    std::optional<size_t> Turtle::findNearestPathSegment(ImVec2 point, float maxDistance) const
+    {
+        m_segmentIndex.update(m_path);
+        return m_segmentIndex.findNearest(m_path, point, maxDistance);
+    }
+
     // +++++++++++++++++++++++++++++++++++++++
     // Tortoise
     // +++++++++++++++++++++++++++++++++++++++
@@ -162,9 +280,10 @@ namespace turtlepreter
     {
     }
 
-    std::string CommandMove::toString()
+    void CommandMove::appendLabel(std::string &label) const
     {
-        return "Move by " + std::to_string(m_d);
+        label += "Move by ";
+        appendLabelNumber(label, m_d);
     }
 
     void CommandMove::executeOnTurtle(Turtle &t)
@@ -191,9 +310,11 @@ namespace turtlepreter
         t.rotate(m_angleRad);
     }
 
-    std::string CommandRotate::toString()
+    void CommandRotate::appendLabel(std::string &label) const
     {
-        return "Rotate by " + std::to_string(m_angleRad) + " radians";
+        label += "Rotate by ";
+        appendLabelNumber(label, m_angleRad);
+        label += " radians";
     }
     void CommandRotate::log(std::ostream &ost) const
     {
@@ -209,9 +330,13 @@ namespace turtlepreter
     {
     }
 
-    std::string CommandJump::toString()
+    void CommandJump::appendLabel(std::string &label) const
     {
-        return "Jump to [" + std::to_string(m_x) + ";" + std::to_string(m_y) + "]";
+        label += "Jump to [";
+        appendLabelNumber(label, m_x);
+        label += ';';
+        appendLabelNumber(label, m_y);
+        label += ']';
     }
 
     void CommandJump::executeOnTurtle(Turtle &t)
@@ -232,14 +357,17 @@ namespace turtlepreter
     {
     }
 
-    std::string CommandSetColor::toString()
+    void CommandSetColor::appendLabel(std::string &label) const
     {
-        int r = (int)(m_color.Value.x);
-        int g = (int)(m_color.Value.y);
-        int b = (int)(m_color.Value.z);
-        int a = (int)(m_color.Value.w);
-
-        return ("Set color (" + std::to_string(r) + "," + std::to_string(g) + "," + std::to_string(b) + "," + std::to_string(a) + ")");
+        label += "Set color (";
+        appendLabelNumber(label, (int)(m_color.Value.x));
+        label += ',';
+        appendLabelNumber(label, (int)(m_color.Value.y));
+        label += ',';
+        appendLabelNumber(label, (int)(m_color.Value.z));
+        label += ',';
+        appendLabelNumber(label, (int)(m_color.Value.w));
+        label += ')';
     }
 
     void CommandSetColor::executeOnTurtle(Turtle &turtle)
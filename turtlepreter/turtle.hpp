@@ -2,8 +2,14 @@
 #define TURTLEPRETER_TURTLE_HPP
 
 #include "controllable.hpp"
+#include "path_raster.hpp"
+#include "path_store.hpp"
 #include "perk.hpp"
+#include "segment_index.hpp"
 
+#include <cstdint>
+#include <filesystem>
+#include <optional>
 #include <vector>
 #include <imgui/imgui.h>
 
@@ -24,9 +30,14 @@ namespace turtlepreter
     class Turtle : virtual public Controllable
     {
     public:
+        static constexpr ImU32 k_canvasColor = IM_COL32(60, 60, 60, 255);
+
         Turtle(const std::string &imgPath);
         Turtle(const std::string &imgPath, float centerX, float centerY);
 
+        // Full chunks come from the raster, only the segments of the last
+        // chunk are emitted as lines, and only those inside the clip
+        // rectangle. Without a GL context every visible segment is a line.
         void draw(const friimgui::Region &region);
         void reset();
 
@@ -37,12 +48,34 @@ namespace turtlepreter
         size_t getPathSegmentCount() const;
         ImVec4 getPathSegmentPoints(size_t i) const;
         ImColor getPathSegmentColor(size_t i) const;
+        const PathStore &getPath() const;
+        // Resident chunks and the raster, without the spilled chunks
+        size_t getPathMemoryBytes() const;
+        void setPathResidentLimit(size_t bytes);
+        void savePath(const std::filesystem::path &fileName) const;
+        void loadPath(const std::filesystem::path &fileName);
         void setColor(ImColor color);
 
+        void setProvenance(std::uint32_t provenance) override;
+        // Off by default. The provenance is kept as the tags of the path,
+        // so it is spilled with the chunks.
+        void setProvenanceEnabled(bool enabled);
+        bool isProvenanceEnabled() const;
+        std::optional<std::uint32_t> getPathSegmentProvenance(size_t i) const;
+        std::optional<size_t> findNearestPathSegment(ImVec2 point, float maxDistance) const;
+        size_t getOutputSize() const override;
+
     private:
-        std::vector<ImVec4>     path;
+        void pushPathSegment(ImVec2 orig, ImVec2 dest);
+
+        PathStore               m_path;
         ImColor                 m_color;
-        std::vector<ImColor>    m_path_color;
+
+        bool                        m_provenanceEnabled;
+        std::uint32_t               m_provenance;
+        size_t                      m_provenanceBase;
+        mutable SegmentIndex        m_segmentIndex;
+        PathRaster                  m_raster;
     };
 
     class Tortoise : public Turtle, public Runner
@@ -61,7 +94,7 @@ namespace turtlepreter
     {
     public:
         CommandMove(float d);
-        std::string toString() override;
+        void appendLabel(std::string &label) const override;
         void executeOnTurtle(Turtle &t) override;
         void log(std::ostream &ost) const override;
 
@@ -76,7 +109,7 @@ namespace turtlepreter
     {
     public:
         CommandJump(float x, float y);
-        std::string toString() override;
+        void appendLabel(std::string &label) const override;
         void executeOnTurtle(Turtle &t) override;
         void log(std::ostream &ost) const override;
 
@@ -94,7 +127,7 @@ namespace turtlepreter
     {
     public:
         CommandRotate(float angle);
-        std::string toString() override;
+        void appendLabel(std::string &label) const override;
         void executeOnTurtle(Turtle &t) override;
         void log(std::ostream &ost) const override;
 
@@ -110,7 +143,7 @@ namespace turtlepreter
     {
     public:
         CommandSetColor(ImColor color);
-        std::string toString() override;
+        void appendLabel(std::string &label) const override;
         void executeOnTurtle(Turtle &turtle) override;
         void log(std::ostream &ost) const override;
 
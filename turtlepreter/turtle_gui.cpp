@@ -1,5 +1,10 @@
 #include "turtle_gui.hpp"
+#include "path_exporter.hpp"
+#include "turtle.hpp"
+#include <algorithm>
 #include <iostream>
+#include <stdexcept>
+#include <libfriimgui/frame_profiler.hpp>
 #include <libfriimgui/types.hpp>
 
 #include <imgui/imgui.h>
@@ -7,10 +12,29 @@
 namespace turtlepreter
 {
 
+    namespace
+    {
+        const float cPickDistance = 6.0f;
+        // Steps taken in one frame at most, so a stalled frame does not
+        // make the next one catch up for long
+        const int cMaxStepsPerFrame = 100000;
+    }
+
     TurtleGUI::TurtleGUI(Controllable *controllable, Interpreter *interpreter)
         : m_controllable(controllable),
           m_interpreter(interpreter),
-          m_widthLeftPanel(200)
+          m_widthLeftPanel(200),
+          m_canvasSize(0, 0),
+          m_selectedNode(nullptr),
+          m_selectedSegment(),
+          m_playing(false),
+          m_playRate(1000),
+          m_playCredit(0),
+          m_followCurrent(true),
+          m_followedNode(nullptr),
+          m_treeView(interpreter),
+          m_memoryPanel(controllable, interpreter),
+          m_profilerPanel(interpreter)
     {
     }
 
@@ -18,6 +42,11 @@ namespace turtlepreter
     {
         ImGuiIO &io = ImGui::GetIO();
 
+        if (m_playing)
+        {
+            play();
+        }
+
         ImGui::SetNextWindowPos(ImVec2(0, 0));
         ImGui::SetNextWindowSize(io.DisplaySize);
 
@@ -34,6 +63,19 @@ namespace turtlepreter
         buildRightPanel();
 
         ImGui::End();
+
+        m_memoryPanel.build();
+        if (Node *hotNode = m_profilerPanel.build())
+        {
+            clearSelection();
+            m_selectedNode = hotNode;
+            m_treeView.reveal(hotNode);
+        }
+    }
+
+    bool TurtleGUI::isAnimating() const
+    {
+        return m_playing;
     }
 
     void TurtleGUI::buildTopBar()
@@ -44,6 +86,8 @@ namespace turtlepreter
             // Resetujem pred runom
             m_controllable->reset();
             m_interpreter->reset();
+            clearSelection();
+            m_playing = false;
 
             m_interpreter->interpretAll(*m_controllable);
         }
@@ -57,17 +101,114 @@ namespace turtlepreter
 
         ImGui::SameLine();
 
+        if (ImGui::Button(m_playing ? "Pause" : "Play", ImVec2(100, 0)))
+        {
+            m_playing = !m_playing && !m_interpreter->isFinished();
+            m_playCredit = 0;
+        }
+
+        ImGui::SameLine();
+
         if (ImGui::Button("Reset", ImVec2(100, 0)))
         {
             m_controllable->reset();
             m_interpreter->reset();
+            clearSelection();
+            m_playing = false;
+        }
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("Save PNG", ImVec2(100, 0)))
+        {
+            exportPng();
+        }
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("Save SVG", ImVec2(100, 0)))
+        {
+            exportSvg();
+        }
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("Save Path", ImVec2(100, 0)))
+        {
+            savePath();
+        }
+
+        ImGui::SameLine();
+
+        if (ImGui::Button("Load Path", ImVec2(100, 0)))
+        {
+            loadPath();
+        }
+
+        ImGui::SameLine();
+
+        friimgui::FrameProfiler &profiler = friimgui::FrameProfiler::getInstance();
+        bool profilerVisible = profiler.isOverlayVisible();
+        if (ImGui::Checkbox("Profiler", &profilerVisible))
+        {
+            profiler.setOverlayVisible(profilerVisible);
+        }
+
+        ImGui::SameLine();
+
+        bool memoryVisible = m_memoryPanel.isVisible();
+        if (ImGui::Checkbox("Memory", &memoryVisible))
+        {
+            m_memoryPanel.setVisible(memoryVisible);
+        }
+
+        ImGui::SameLine();
+
+        bool hotSpotsVisible = m_profilerPanel.isVisible();
+        if (ImGui::Checkbox("Hot spots", &hotSpotsVisible))
+        {
+            m_profilerPanel.setVisible(hotSpotsVisible);
+        }
+
+        ImGui::SetNextItemWidth(200);
+        ImGui::SliderInt("##speed", &m_playRate, 1, 1000000, "%d steps/s", ImGuiSliderFlags_Logarithmic);
+
+        ImGui::SameLine();
+
+        ImGui::Checkbox("Follow", &m_followCurrent);
+    }
+
+    void TurtleGUI::play()
+    {
+        m_playCredit += ImGui::GetIO().DeltaTime * m_playRate;
+        const int stepCount = static_cast<int>(std::min<double>(m_playCredit, cMaxStepsPerFrame));
+        // Credit beyond one frame of steps is dropped, so a slow frame does
+        // not make playback run at the cap for many frames after it
+        m_playCredit = std::min<double>(m_playCredit - stepCount, cMaxStepsPerFrame);
+        if (stepCount > 0)
+        {
+            m_interpreter->interpretSteps(*m_controllable, stepCount);
+        }
+        if (m_interpreter->isFinished())
+        {
+            m_playing = false;
         }
     }
 
     void TurtleGUI::buildLeftPanel()
     {
         ImGui::BeginChild("Script", ImVec2(m_widthLeftPanel, 0), true);
-        populateTreeNodes(m_interpreter->getRoot());
+
+        // Revealing expands the ancestors only once, the row index makes
+        // it cheap to follow a node every frame
+        const Node *current = m_interpreter->getCurrent();
+        if (m_followCurrent && current != m_followedNode)
+        {
+            m_treeView.reveal(current);
+        }
+        m_followedNode = current;
+
+        m_treeView.build(m_selectedNode, current);
         ImGui::EndChild();
     }
 
@@ -98,34 +239,149 @@ namespace turtlepreter
 
         ImDrawList *drawList = ImGui::GetWindowDrawList();
         friimgui::Region region = friimgui::Region::createFromAvail();
+        m_canvasSize = region.calculateSize();
         drawList->AddRectFilled(
             region.getP0(),
             region.getP2(),
-            IM_COL32(60, 60, 60, 255));
+            Turtle::k_canvasColor);
         region.reserveSpace();
+        if (ImGui::IsItemClicked())
+        {
+            pickPathSegment(region);
+        }
 
         m_controllable->draw(region);
+        drawSelectedPathSegment(region);
 
         ImGui::EndChild();
     }
 
-    void TurtleGUI::populateTreeNodes(Node *node)
+    void TurtleGUI::pickPathSegment(const friimgui::Region &region)
     {
-        if (node != nullptr)
+        clearSelection();
+
+        Turtle *turtle = dynamic_cast<Turtle *>(m_controllable);
+        if (turtle == nullptr)
         {
-            ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen;
-            const std::string nodeStr = node->toString();
-            if (ImGui::TreeNodeEx(node, flags, "%s", nodeStr.c_str()))
-            {
+            return;
+        }
 
-                for (Node *subnode : node->getSubnodes())
-                {
-                    populateTreeNodes(subnode);
-                }
+        const ImVec2 mouse = ImGui::GetMousePos();
+        const ImVec2 p0 = region.getP0();
+        m_selectedSegment = turtle->findNearestPathSegment(ImVec2(mouse.x - p0.x, mouse.y - p0.y), cPickDistance);
+        if (!m_selectedSegment)
+        {
+            return;
+        }
 
-                ImGui::TreePop();
-            }
+        if (std::optional<std::uint32_t> provenance = turtle->getPathSegmentProvenance(*m_selectedSegment))
+        {
+            m_selectedNode = m_interpreter->getNode(*provenance);
+            m_treeView.reveal(m_selectedNode);
+        }
+    }
+
+    void TurtleGUI::drawSelectedPathSegment(const friimgui::Region &region)
+    {
+        Turtle *turtle = dynamic_cast<Turtle *>(m_controllable);
+        if (turtle == nullptr || !m_selectedSegment || *m_selectedSegment >= turtle->getPathSegmentCount())
+        {
+            return;
+        }
+
+        const ImVec4 segment = turtle->getPathSegmentPoints(*m_selectedSegment);
+        const ImVec2 p0 = region.getP0();
+        ImGui::GetWindowDrawList()->AddLine(
+            ImVec2(p0.x + segment.x, p0.y + segment.y),
+            ImVec2(p0.x + segment.z, p0.y + segment.w),
+            IM_COL32(255, 255, 0, 255),
+            3.0f);
+    }
+
+    // Runs on the GUI thread, the window stops responding until the file is
+    // written. Drawing the path reads the same PathStore, whose caches are
+    // not safe to share with an export thread.
+    void TurtleGUI::exportPng()
+    {
+        const Turtle *turtle = dynamic_cast<const Turtle *>(m_controllable);
+        const int width = static_cast<int>(m_canvasSize.x);
+        const int height = static_cast<int>(m_canvasSize.y);
+        if (turtle == nullptr || width <= 0 || height <= 0)
+        {
+            return;
+        }
+
+        try
+        {
+            PathExporter::exportPng(*turtle, "turtlepreter.png", width, height);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    void TurtleGUI::exportSvg()
+    {
+        const Turtle *turtle = dynamic_cast<const Turtle *>(m_controllable);
+        const int width = static_cast<int>(m_canvasSize.x);
+        const int height = static_cast<int>(m_canvasSize.y);
+        if (turtle == nullptr || width <= 0 || height <= 0)
+        {
+            return;
+        }
+
+        try
+        {
+            PathExporter::exportSvg(*turtle, "turtlepreter.svg", width, height);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    void TurtleGUI::savePath()
+    {
+        const Turtle *turtle = dynamic_cast<const Turtle *>(m_controllable);
+        if (turtle == nullptr)
+        {
+            return;
+        }
+
+        try
+        {
+            turtle->savePath("turtlepreter.tpath");
         }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    void TurtleGUI::loadPath()
+    {
+        Turtle *turtle = dynamic_cast<Turtle *>(m_controllable);
+        if (turtle == nullptr)
+        {
+            return;
+        }
+
+        clearSelection();
+        try
+        {
+            turtle->loadPath("turtlepreter.tpath");
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+
+    void TurtleGUI::clearSelection()
+    {
+        m_selectedNode = nullptr;
+        m_selectedSegment.reset();
     }
 
 } // namespace turtlepreter
@@ -3,8 +3,14 @@
 
 #include "interpreter.hpp"
 #include "controllable.hpp"
+#include "memory_panel.hpp"
+#include "profiler_panel.hpp"
+#include "tree_view.hpp"
 
 #include <libfriimgui/gui_builder.hpp>
+#include <libfriimgui/types.hpp>
+
+#include <optional>
 
 namespace turtlepreter
 {
@@ -15,17 +21,40 @@ namespace turtlepreter
         TurtleGUI(Controllable *controllable, Interpreter *interpreter);
 
         void build() override;
+        bool isAnimating() const override;
 
     private:
         void buildTopBar();
+        void play();
         void buildLeftPanel();
         void buildSplitter();
         void buildRightPanel();
-        void populateTreeNodes(Node *node);
+        void pickPathSegment(const friimgui::Region &region);
+        void drawSelectedPathSegment(const friimgui::Region &region);
+        void clearSelection();
+        void exportPng();
+        void exportSvg();
+        void savePath();
+        void loadPath();
 
         Controllable *m_controllable;
         Interpreter *m_interpreter;
         size_t m_widthLeftPanel;
+        ImVec2 m_canvasSize;
+
+        Node *m_selectedNode;
+        std::optional<size_t> m_selectedSegment;
+
+        bool m_playing;
+        int m_playRate;
+        double m_playCredit;
+        bool m_followCurrent;
+        const Node *m_followedNode;
+
+        TreeView m_treeView;
+
+        MemoryPanel m_memoryPanel;
+        ProfilerPanel m_profilerPanel;
     };
 
 } // namespace turtlepreter